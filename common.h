@@ -38,6 +38,7 @@ SOFTWARE.
 #include <pthread.h>
 #include <math.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 
@@ -52,11 +53,11 @@ SOFTWARE.
 // general
 #define MB 0x100000
 
-// max constants
-#define MAX_GRID_X          52
-#define MAX_GRID_Y          52
-#define MAX_COMPONENT       10000
-#define MAX_NODE            10000
+// max constants; the grid, component, and node tables are allocated, and 
+// grow as needed; the grid holds only the grid locations that are used, 
+// whose x and y are less than MAX_GRID_X and MAX_GRID_Y
+#define MAX_GRID_X          100000
+#define MAX_GRID_Y          100000
 #define MAX_GRID_TERM       5
 #define MAX_HISTORY         500
 #define MAX_SCOPE           16
@@ -101,12 +102,13 @@ SOFTWARE.
 #define PARAM_VOLTAGE         6
 #define PARAM_COMPONENT       7
 #define PARAM_INTERMEDIATE    8
-#define PARAM_CENTER          9
-#define PARAM_SCALE           10
-#define PARAM_SCOPE_MODE      11
-#define PARAM_SCOPE_TRIGGER   12
-#define PARAM_SCOPE_SPAN_T    13  
-#define PARAM_SCOPE_A         14  // for len MAX_SCOPE
+#define PARAM_MULTIRATE       9
+#define PARAM_CENTER          10
+#define PARAM_SCALE           11
+#define PARAM_SCOPE_MODE      12
+#define PARAM_SCOPE_TRIGGER   13
+#define PARAM_SCOPE_SPAN_T    14  
+#define PARAM_SCOPE_A         15  // for len MAX_SCOPE
 
 #define param_has_changed(id) \
     ({ static int32_t last_update_count=-1; \
@@ -116,13 +118,22 @@ SOFTWARE.
        result; })
 
 // range allowed for scaling (zoom) the display
-#define MIN_GRID_SCALE     100
+#define MIN_GRID_SCALE     20
 #define MAX_GRID_SCALE     400
 
 // power supply wave form
-#define WAVE_FORM_SINE      0
-#define WAVE_FORM_SQUARE    1
-#define WAVE_FORM_TRIANGLE  2
+#define WAVE_FORM_DC        0
+#define WAVE_FORM_SINE      1
+#define WAVE_FORM_SQUARE    2
+#define WAVE_FORM_TRIANGLE  3
+#define WAVE_FORM_PULSE     4
+#define WAVE_FORM_PWL       5
+#define WAVE_FORM_FILE      6
+
+// max length of a power supply value string, such as a pwl spec; so that the
+// 'add power' line written by the write command can be read by the read command,
+// and the value fits in the buffers used to show and display it
+#define MAX_WAVEFORM_STR    150
 
 //
 // typedefs
@@ -130,6 +141,7 @@ SOFTWARE.
 
 struct component_s;
 struct node_s;
+struct waveform_table_s;
 
 typedef struct {
     float min;
@@ -152,7 +164,7 @@ typedef struct component_s {
     // these fields describe the component
     int32_t type;
     char * type_str;
-    char comp_str[8];
+    char comp_str[16];
     terminal_t term[2];
     union {
         struct {
@@ -161,8 +173,12 @@ typedef struct component_s {
         } wire;
         struct {
             long double volts;
-            long double hz;  // 0 = DC
+            long double hz;  // 0 = DC or PWL
             int32_t wave_form;
+            long double rise;    // pulse
+            long double fall;    // pulse
+            long double width;   // pulse
+            struct waveform_table_s * table;  // pwl and file
         } power;
         struct {
             long double ohms;
@@ -181,54 +197,172 @@ typedef struct component_s {
     // component state, used by model.c, follow:
     // when clearing component state, init from here
     int32_t start_init_component_state;
+    bool slow;
     long double i_next;
     long double i_now;
     long double diode_ohms;
-    hist_t i_history[MAX_HISTORY];
-    tma_t * watts;
+    wa_t watts;
 } component_t;
 
+// a grid location that has a terminal or the ground, see grid_get; the grid 
+// locations that are connected by wires are sets of a union-find, see grid_find;
+// uf_parent is NULL when this grid location is the root of its set
 typedef struct grid_s {
+    gridloc_t gl;
     terminal_t * term[MAX_GRID_TERM];
     int32_t max_term;
-    char glstr[4];
-    bool ground;
     bool has_remote_wire;
     int32_t remote_wire_color;
     struct node_s * node;
+    struct grid_s * uf_parent;
+    int32_t uf_rank;
+    struct grid_s * hash_next;
 } grid_t;
 
 typedef struct node_s {
+    // these fields describe the node, they are set when the netlist is
+    // compiled, see init_nodes; the term list is a slice of the netlist's arena
     terminal_t ** term;
-    gridloc_t * gridloc;
-    int32_t max_alloced_term;
-    int32_t max_alloced_gridloc;
-    // when clearing a node, init from here
-    int32_t start_init_node_state;
     int32_t max_term;
-    int32_t max_gridloc;
     bool ground;
     terminal_t * power;
+    // node state, used by model.c, follows:
+    // when clearing node state, init from here
+    int32_t start_init_node_state;
     long double v_next;
     long double v_now;
     long double dv_dt;
-    hist_t v_history[MAX_HISTORY];
+    bool slow;                  // in the slow partition, see multirate_partition
+    long double v_slow_start;   // the slow node's voltage is interpolated from
+    long double v_slow_end;     //  v_slow_start to v_slow_end over the slow step
 } node_t;
 
+// probes record the history of the values displayed by the scopes;
+// there is one probe for each scope, and these are resolved from the
+// scope params by the model_thread
+#define PROBE_NONE     0
+#define PROBE_VOLTAGE  1
+#define PROBE_CURRENT  2
+
+// the probe history is a min/max pyramid; level 0 buckets span the base_t
+// that is set when the model is run, and each level's buckets span twice 
+// the time of the prior level's; each level is a ring that retains the 
+// most recent PROBE_MAX_BUCKET buckets, so recent history is retained at 
+// fine resolution and older history at coarser resolution
+#define PROBE_MAX_LEVEL   32
+#define PROBE_MAX_BUCKET  1024
+
+typedef struct {
+    int64_t  newest;   // index of the newest bucket, -1 if none
+    hist_t * bucket;
+} probe_level_t;
+
+typedef struct {
+    int32_t       type;
+    int32_t       units;
+    long double   ymin;
+    long double   ymax;
+    gridloc_t     gl0;
+    gridloc_t     gl1;
+    char          title[100];
+    node_t      * node0;      // voltage probe records node0 - node1
+    node_t      * node1;
+    component_t * component;  // current probe records sign * component current
+    float         sign;
+    hist_t      * history;    // allocated when the probe is first used
+    uint64_t      history_gen;  // incremented when the history is cleared
+    probe_level_t level[PROBE_MAX_LEVEL];
+} probe_t;
+
+// the solver's phases, whose cpu time is measured by the model_thread
+// with perf counters, see 'show perf'
+#define PERF_PHASE_NODE_V    0   // node voltages
+#define PERF_PHASE_COMP_I    1   // component currents
+#define PERF_PHASE_POWER_I   2   // power supply currents
+#define PERF_PHASE_DV_DT     3   // node dv_dt
+#define PERF_PHASE_STABLE    4   // circuit_is_stable
+#define PERF_PHASE_COMMIT    5   // move next values to now values
+#define PERF_PHASE_WATTS     6   // windowed_average of component power
+#define PERF_PHASE_PROBE     7   // probe_record history
+#define MAX_PERF_PHASE       8
+#define PERF_PHASE_STR(x) \
+    ((x) == PERF_PHASE_NODE_V  ? "node_v"  : \
+     (x) == PERF_PHASE_COMP_I  ? "comp_i"  : \
+     (x) == PERF_PHASE_POWER_I ? "power_i" : \
+     (x) == PERF_PHASE_DV_DT   ? "dv_dt"   : \
+     (x) == PERF_PHASE_STABLE  ? "stable"  : \
+     (x) == PERF_PHASE_COMMIT  ? "commit"  : \
+     (x) == PERF_PHASE_WATTS   ? "watts"   : \
+     (x) == PERF_PHASE_PROBE   ? "probe"   : \
+                                 "????")
+
+// histogram of the iterations needed by each step to stabilize;
+// bucket n counts the steps that needed 2^n to 2^(n+1)-1 iterations
+#define MAX_PERF_HIST        18
+
+// solver configuration; this is a snapshot of the params that are used by 
+// the model_thread, it is published by param_set whenever one of these 
+// params changes, so that the model_thread never needs to parse param strings
+typedef struct {
+    uint64_t    version;
+    long double delta_t;
+    long double scope_span_t;
+    bool        scope_trigger;
+    bool        scope_continuous;
+    bool        dcpwr_ramp;
+    bool        intermediate;
+    int32_t     multirate;    // ratio of the slow partition's step to delta_t, 0 is off
+} solver_config_t;
+
+// snapshot of the circuit values, published by the model_thread for the 
+// display; the node and component values are indexed by node and component
+// index, and are the intermediate values when the intermediate param is on;
+// the v, i, and watts arrays are allocated by model_get_snapshot
+typedef struct {
+    int32_t     model_state;
+    long double model_t;
+    long double delta_t;
+    long double stop_t;
+    int32_t     failed_to_stabilize_count;
+    uint64_t    total_steps;       // delta_t steps since the model was run
+    uint64_t    total_iterations;  // iterations needed to stabilize these steps
+    int32_t     max_iterations;    // most iterations needed by a single step
+    uint64_t    perf_ticks[MAX_PERF_PHASE];  // perf counter ticks spent in each phase
+    uint64_t    perf_sampled_steps;          // steps that were timed
+    uint64_t    perf_total_ticks;            // ticks spent in the timed steps
+    uint64_t    perf_ticks_per_sec;
+    uint64_t    iteration_hist[MAX_PERF_HIST];
+    int32_t     max_slow_node;     // nodes in the multirate slow partition
+    uint64_t    total_slow_steps;  // steps of the slow partition
+    int32_t     max_node;
+    int32_t     max_component;
+    int32_t     max_alloced_node;
+    int32_t     max_alloced_component;
+    long double * v;
+    long double * i;
+    long double * watts;
+} model_snapshot_t;
+
 //
 // variables
 //
 
-component_t component[MAX_COMPONENT];
+component_t * component;
 int32_t     max_component;
+int32_t     max_alloced_component;
 
 gridloc_t   ground;
 bool        ground_is_set;
 
-grid_t      grid[MAX_GRID_X][MAX_GRID_Y];
+grid_t   ** grid;         // the grid locations that are used, in the order added
+int32_t     max_grid;
+int32_t     max_alloced_grid;
 
-node_t      node[MAX_NODE];
+node_t    * node;
 int32_t     max_node;
+int32_t     max_alloced_node;
+
+uint64_t    netlist_version;  // incremented when the circuit's netlist is changed
 
 int32_t     model_state;
 long double model_t;
@@ -237,7 +371,7 @@ long double stop_t;
 int32_t     failed_to_stabilize_count;
 
 long double history_t;
-int32_t     max_history;
+probe_t     probe[MAX_SCOPE];
 
 char        current_filename[200];
 int32_t     scope_select_idx;
@@ -249,8 +383,11 @@ int32_t     scope_select_idx;
 // main.c
 char * gridloc_to_str(gridloc_t * gl, char * s);
 int32_t str_to_gridloc(char *glstr, gridloc_t * gl);
-char * component_to_value_str(component_t * c, char * s);
-char * component_to_full_str(component_t * c, char * s);
+grid_t * grid_get(gridloc_t * gl);
+gridloc_t grid_find(gridloc_t gl);
+bool grid_is_ground(gridloc_t * gl);
+char * component_to_value_str(component_t * c, char * s, int32_t size);
+char * component_to_full_str(component_t * c, char * s, int32_t size);
 int32_t str_to_val(char * s, int32_t units, long double * val_result);
 char * val_to_str(long double val, int32_t units, char * s, bool shorten);
 int32_t param_set(int32_t id, char *str);
@@ -260,12 +397,33 @@ char * param_str_val(int32_t id);
 char * param_default_str_val(int32_t id);
 long double param_num_val(int32_t id);
 int32_t param_update_count(int32_t id);
+void param_get_solver_config(solver_config_t * cfg);
+uint64_t param_solver_config_version(void);
+
+// waveform.c
+int32_t waveform_parse(component_t * c, char * value_str);
+char * waveform_to_str(component_t * c, char * s, int32_t size);
+void waveform_free(component_t * c);
+long double waveform_hz(component_t * c);
+long double waveform_eval(component_t * c, long double t);
+long double waveform_next_breakpoint(component_t * c, long double t);
+
+// probe.c
+void probe_reset_history(long double base_t);
+void probe_resolve(void);
+void probe_get(int32_t idx, probe_t * p);
+void probe_record(long double t);
+void probe_get_history(probe_t * p, long double t_start, long double t_span, int32_t width, hist_t * out);
+int32_t probe_get_newest(probe_t * p, long double * t_start, long double * t_end);
 
 // display.c
 void display_init(void);
 void display_lock(void);
 void display_unlock(void);
-void display_handler(void);
+void display_handler(bool offscreen);
+void display_print_screen(char * filename);
+int32_t display_record(char * filename);
+int32_t display_sync(void);
 
 // model.c
 void model_init(void);
@@ -274,5 +432,10 @@ int32_t model_run(void);
 int32_t model_stop(void);
 int32_t model_cont(void);
 int32_t model_step(void);
+int32_t model_wait_not_running(uint64_t timeout_us);
+void model_wakeup(void);
+void model_set_component_value(component_t * c, component_t * new_value);
+void model_get_snapshot(model_snapshot_t * snap);
+uint64_t model_update_count(void);
 
 #endif
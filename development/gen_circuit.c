@@ -0,0 +1,598 @@
+#include <common.h>
+
+// generates synthetic circuits, which are used to measure how the solver
+// scales with node count and stiffness, see test/run_bench
+//
+// usage: gen_circuit grid       [-c] [-m] [-s <seed>] [<size>]
+//        gen_circuit rc_ladder  [-r <ohms>] [-f <farads>] [-w <width>] <stages>
+//        gen_circuit rlc        [-d <density>] [-s <seed>] <nodes>
+//        gen_circuit multiplier [-v <volts>] [-f <farads>] [-h <hz>] <stages>
+//
+// the circuit is written to stdout; except for the plain grid, the circuit
+// is complete, with clear_all, power, ground, and scopes; all components
+// connect adjacent grid locations, so large circuits are folded to keep the
+// schematic compact
+
+#define DEFAULT_SEED      1
+#define DEFAULT_GRID_SIZE 52
+
+static int32_t gen_grid(int32_t argc, char **argv);
+static int32_t gen_rc_ladder(int32_t argc, char **argv);
+static int32_t gen_rlc(int32_t argc, char **argv);
+static int32_t gen_multiplier(int32_t argc, char **argv);
+
+static void add_comp(int32_t type, int32_t x0, int32_t y0, int32_t x1, int32_t y1, long double value);
+static void add_power(int32_t x0, int32_t y0, int32_t x1, int32_t y1, char *value_str);
+static void add_wire_chain(int32_t *pts, int32_t max_pts, int32_t fixed, bool fixed_is_x);
+static long double random_log(long double min, long double max);
+static int32_t parse_count(char *s, int32_t min, int32_t max, int32_t *result);
+static int32_t parse_value(char *s, long double *result);
+static char * xy_str(int32_t x, int32_t y);
+static char * make_gridloc_str(gridloc_t * gl);
+static char * make_component_str(component_t * c);
+
+static char * comp_type_str[] = { "none", "wire", "power", "resistor", "capacitor", "inductor", "diode" };
+
+int32_t main(int32_t argc, char **argv)
+{
+    int32_t i;
+
+    static struct {
+        char * name;
+        int32_t (*proc)(int32_t argc, char **argv);
+    } gen_tbl[] = {
+        { "grid",        gen_grid       },
+        { "rc_ladder",   gen_rc_ladder  },
+        { "rlc",         gen_rlc        },
+        { "multiplier",  gen_multiplier },
+            };
+
+    // call the generator for the circuit type, argv[1]; the generator's
+    // options are parsed by getopt starting with argv[1]
+    if (argc >= 2) {
+        for (i = 0; i < sizeof(gen_tbl)/sizeof(gen_tbl[0]); i++) {
+            if (strcmp(argv[1], gen_tbl[i].name) == 0) {
+                return gen_tbl[i].proc(argc-1, argv+1);
+            }
+        }
+    }
+
+    fprintf(stderr,
+            "usage: gen_circuit grid       [-c] [-m] [-s <seed>] [<size>]\n"
+            "       gen_circuit rc_ladder  [-r <ohms>] [-f <farads>] [-w <width>] <stages>\n"
+            "       gen_circuit rlc        [-d <density>] [-s <seed>] <nodes>\n"
+            "       gen_circuit multiplier [-v <volts>] [-f <farads>] [-h <hz>] <stages>\n");
+    return 1;
+}
+
+// -----------------  GRID  ----------------------------------------------
+
+// size by size grid of resistors, default 1 ohm, this is the infinite 1ohm
+// resistor grid in test/r3; the middle row has no resistors along it, and
+// is joined to the next row by wires
+// - size: the grid is size by size grid locations, default DEFAULT_GRID_SIZE
+// - -c:   generate a complete circuit, with clear_all, power and ground
+//         at the center of the grid
+// - -m:   mixed values, the resistors are 1 to 10K ohms, and 1 in 5 is
+//         replaced by a 1uF to 1mF capacitor; the values are random with
+//         a log distribution, and the -s seed
+static int32_t gen_grid(int32_t argc, char **argv)
+{
+    int32_t x, y, size, mid, seed=DEFAULT_SEED;
+    bool complete = false, mixed = false;
+
+    while (true) {
+        int32_t opt_char = getopt(argc, argv, "cms:");
+        if (opt_char == -1) {
+            break;
+        }
+        switch (opt_char) {
+        case 'c':
+            complete = true;
+            break;
+        case 'm':
+            mixed = true;
+            break;
+        case 's':
+            if (parse_count(optarg, 0, INT32_MAX, &seed) < 0) return 1;
+            break;
+        default:
+            return 1;
+        }
+    }
+    size = DEFAULT_GRID_SIZE;
+    if (argc - optind >= 1) {
+        if (parse_count(argv[optind], 4, MAX_GRID_X, &size) < 0) return 1;
+    }
+    mid = size / 2;
+    srandom(seed);
+
+    if (complete) {
+        printf("# gen_circuit grid%s -s %d %d\n", mixed ? " -m" : "", seed, size);
+        printf("clear_all\n\n");
+    }
+
+    for (x = 0; x < size-1; x++) {
+        for (y = 0; y < size; y++) {
+            if (y == mid) {
+                continue;
+            }
+            if (mixed && random() % 5 == 0) {
+                add_comp(COMP_CAPACITOR, x, y, x+1, y, random_log(1e-6, 1e-3));
+            } else {
+                add_comp(COMP_RESISTOR, x, y, x+1, y, mixed ? random_log(1, 1e4) : 1);
+            }
+        }
+    }
+    printf("\n");
+
+    for (x = 0; x < size; x++) {
+        for (y = 0; y < size-1; y++) {
+            if (y == mid) {
+                add_comp(COMP_WIRE, x, y, x, y+1, 0);
+            } else if (mixed && random() % 5 == 0) {
+                add_comp(COMP_CAPACITOR, x, y, x, y+1, random_log(1e-6, 1e-3));
+            } else {
+                add_comp(COMP_RESISTOR, x, y, x, y+1, mixed ? random_log(1, 1e4) : 1);
+            }
+        }
+    }
+    printf("\n");
+
+    if (complete) {
+        add_power(mid-1, mid, mid, mid, "1v");
+        printf("ground %s\n", xy_str(mid, mid));
+    }
+
+    return 0;
+}
+
+// -----------------  RC LADDER  -----------------------------------------
+
+// ladder of stages, each stage is a series resistor and a capacitor to ground,
+// driven by a 1v step; the time constant of the ladder grows with the square
+// of the number of stages, which makes it stiff
+// - -r, -f: the resistor and capacitor values, default 1K ohm and 1uF
+// - -w:     the ladder is folded into rows of width stages, default 100
+//
+// layout: the ladder's rows are at odd y, and alternate direction; the ladder
+// turns down to the next row with a wire at the end of the row, which leaves
+// the ground rail between the rows open on the other side; these ground rails
+// are joined to a ground frame on the left, top, and right
+static int32_t gen_rc_ladder(int32_t argc, char **argv)
+{
+    int32_t stages, width=100, k, x, y, dir, row, max_row, turn_x, i, n;
+    long double ohms=1000, farads=1e-6;
+    int32_t *rail_x, *max_rail_x, *pts, max_pts;
+    int32_t spine_y[2][MAX_GRID_Y/2], max_spine_y[2];
+
+    while (true) {
+        int32_t opt_char = getopt(argc, argv, "r:f:w:");
+        if (opt_char == -1) {
+            break;
+        }
+        switch (opt_char) {
+        case 'r':
+            if (parse_value(optarg, &ohms) < 0) return 1;
+            break;
+        case 'f':
+            if (parse_value(optarg, &farads) < 0) return 1;
+            break;
+        case 'w':
+            if (parse_count(optarg, 2, MAX_GRID_X-2, &width) < 0) return 1;
+            break;
+        default:
+            return 1;
+        }
+    }
+    if (argc - optind != 1 || parse_count(argv[optind], 1, 10000000, &stages) < 0) {
+        fprintf(stderr, "stages expected\n");
+        return 1;
+    }
+    max_row = stages / (width - 1) + 2;
+    if (2 * max_row + 2 >= MAX_GRID_Y) {
+        fprintf(stderr, "too many stages for width %d\n", width);
+        return 1;
+    }
+
+    // the capacitors' x locations in each row's ground rail
+    rail_x = calloc(max_row * width, sizeof(int32_t));
+    max_rail_x = calloc(max_row, sizeof(int32_t));
+    pts = calloc(width + 2, sizeof(int32_t));
+    assert(rail_x && max_rail_x && pts);
+
+    printf("# gen_circuit rc_ladder -r %Lg -f %Lg -w %d %d\n", ohms, farads, width, stages);
+    printf("clear_all\n\n");
+
+    // the ladder, starting at x=1,y=1; the turn column is x=width at the
+    // end of left-to-right rows, and x=1 at the end of right-to-left rows
+    x = 1;
+    y = 1;
+    dir = 1;
+    row = 0;
+    for (k = 0; k < stages; k++) {
+        add_comp(COMP_RESISTOR, x, y, x+dir, y, ohms);
+        x += dir;
+        turn_x = (dir == 1 ? width : 1);
+        if (x == turn_x) {
+            add_comp(COMP_WIRE, x, y, x, y+2, 0);
+            y += 2;
+            dir = -dir;
+            row++;
+        }
+        add_comp(COMP_CAPACITOR, x, y, x, y+1, farads);
+        rail_x[row*width + max_rail_x[row]++] = x;
+    }
+    printf("\n");
+
+    // the ground rail below each row; even rows' rails are open to the left
+    // and join the left frame at x=0, odd rows' rails join the right frame
+    // at x=width+1; the frames' y values start at the top frame, and the
+    // left frame also has the power supply at y=1
+    spine_y[0][0] = 0;
+    spine_y[0][1] = 1;
+    max_spine_y[0] = 2;
+    spine_y[1][0] = 0;
+    max_spine_y[1] = 1;
+    for (row = 0; row < max_row; row++) {
+        if (max_rail_x[row] == 0) {
+            continue;
+        }
+        n = max_rail_x[row];
+        max_pts = 0;
+        if (row % 2 == 0) {
+            pts[max_pts++] = 0;
+            for (i = 0; i < n; i++) pts[max_pts++] = rail_x[row*width + i];
+        } else {
+            for (i = n-1; i >= 0; i--) pts[max_pts++] = rail_x[row*width + i];
+            pts[max_pts++] = width + 1;
+        }
+        add_wire_chain(pts, max_pts, 2*row+2, false);
+        spine_y[row%2][max_spine_y[row%2]++] = 2*row+2;
+    }
+
+    // the ground frame, and the power supply at the start of the ladder;
+    // the ground is the top left corner
+    add_power(1, 1, 0, 1, "1v");
+    add_wire_chain(spine_y[0], max_spine_y[0], 0, true);
+    add_wire_chain(spine_y[1], max_spine_y[1], width+1, true);
+    add_comp(COMP_WIRE, 0, 0, width+1, 0, 0);
+    printf("\n");
+    printf("ground %s\n\n", xy_str(0, 0));
+
+    // scopes of the first and last capacitor voltages
+    printf("set scope_a voltage,0,1,%s,%s,FIRST\n", xy_str(rail_x[0], 1), xy_str(rail_x[0], 2));
+    printf("set scope_b voltage,0,1,%s,%s,LAST\n", xy_str(x, y), xy_str(x, y+1));
+
+    free(rail_x);
+    free(max_rail_x);
+    free(pts);
+    return 0;
+}
+
+// -----------------  RANDOM SPARSE RLC NETWORK  -------------------------
+
+// nodes, rounded up to a square, joined by a comb of resistors, along each
+// row and down the first column, so that each node has a DC path, and the
+// path lengths grow with the square root of the nodes; the other adjacent
+// nodes are joined by a resistor, capacitor, or inductor with probability
+// density, default .3; the values are random with a log distribution, the
+// resistors 10 to 10K ohms, the capacitors 1uF to 1mF, and the inductors 1mH
+// to 1H, which gives time constants spanning 6 decades; the power supply
+// drives the first node, and the end of each row is joined to ground by a
+// resistor, so that current flows along each row
+static int32_t gen_rlc(int32_t argc, char **argv)
+{
+    int32_t nodes, size, x, y, seed=DEFAULT_SEED;
+    double density = .3;
+
+    while (true) {
+        int32_t opt_char = getopt(argc, argv, "d:s:");
+        if (opt_char == -1) {
+            break;
+        }
+        switch (opt_char) {
+        case 'd':
+            if (sscanf(optarg, "%lf", &density) != 1 || density < 0 || density > 1) {
+                fprintf(stderr, "invalid density '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            if (parse_count(optarg, 0, INT32_MAX, &seed) < 0) return 1;
+            break;
+        default:
+            return 1;
+        }
+    }
+    if (argc - optind != 1 || parse_count(argv[optind], 4, 100000000, &nodes) < 0) {
+        fprintf(stderr, "nodes expected\n");
+        return 1;
+    }
+    size = ceil(sqrt(nodes));
+    if (size + 2 >= MAX_GRID_X) {
+        fprintf(stderr, "too many nodes\n");
+        return 1;
+    }
+    srandom(seed);
+
+    printf("# gen_circuit rlc -d %g -s %d %d\n", density, seed, nodes);
+    printf("clear_all\n\n");
+
+    // the network occupies x=1..size and y=1..size; the comb runs along
+    // the rows, and down the first column
+    for (y = 1; y <= size; y++) {
+        for (x = 1; x < size; x++) {
+            add_comp(COMP_RESISTOR, x, y, x+1, y, random_log(10, 1e4));
+        }
+        if (y < size) {
+            add_comp(COMP_RESISTOR, 1, y, 1, y+1, random_log(10, 1e4));
+        }
+    }
+    printf("\n");
+
+    // the random components, between the rows
+    for (y = 1; y < size; y++) {
+        for (x = 2; x <= size; x++) {
+            if (random() / (RAND_MAX + 1.) >= density) {
+                continue;
+            }
+            switch (random() % 3) {
+            case 0:
+                add_comp(COMP_RESISTOR, x, y, x, y+1, random_log(10, 1e4));
+                break;
+            case 1:
+                add_comp(COMP_CAPACITOR, x, y, x, y+1, random_log(1e-6, 1e-3));
+                break;
+            case 2:
+                add_comp(COMP_INDUCTOR, x, y, x, y+1, random_log(1e-3, 1));
+                break;
+            }
+        }
+    }
+    printf("\n");
+
+    // the ground frame, along the top at y=0 and down the right at x=size+1,
+    // with a resistor from the end of each row; and the power supply at x=0
+    for (y = 1; y <= size; y++) {
+        add_comp(COMP_RESISTOR, size, y, size+1, y, random_log(10, 1e4));
+        add_comp(COMP_WIRE, size+1, y-1, size+1, y, 0);
+    }
+    add_comp(COMP_WIRE, 0, 0, size+1, 0, 0);
+    add_comp(COMP_WIRE, 0, 0, 0, 1, 0);
+    add_power(1, 1, 0, 1, "1v");
+    printf("\n");
+    printf("ground %s\n\n", xy_str(0, 0));
+
+    // scopes of the voltages of the network's second node and last node
+    printf("set scope_a voltage,0,1,%s,%s,SECOND\n", xy_str(2, 1), xy_str(0, 0));
+    printf("set scope_b voltage,0,1,%s,%s,LAST\n", xy_str(size, size), xy_str(0, 0));
+
+    return 0;
+}
+
+// -----------------  DIODE CAPACITOR MULTIPLIER  ------------------------
+
+// Cockcroft-Walton voltage multiplier of stages, each stage is 2 diodes and
+// 2 capacitors, and adds 2 times the peak voltage to the output; it is
+// driven by a sine wave, default 5v 100hz, and the capacitors default to 1mF
+//
+// layout: the pump capacitors are in row y=1, the diodes in row y=2, and
+// the smoothing capacitors in row y=3; stage k's pump node P(k) is at
+// x=2k+1 and smoothing node S(k) is at x=2k+2, and each is joined by a wire
+// to the diode chain
+static int32_t gen_multiplier(int32_t argc, char **argv)
+{
+    int32_t stages, k;
+    long double volts=5, farads=1e-3, hz=100;
+    char power_str[100];
+
+    while (true) {
+        int32_t opt_char = getopt(argc, argv, "v:f:h:");
+        if (opt_char == -1) {
+            break;
+        }
+        switch (opt_char) {
+        case 'v':
+            if (parse_value(optarg, &volts) < 0) return 1;
+            break;
+        case 'f':
+            if (parse_value(optarg, &farads) < 0) return 1;
+            break;
+        case 'h':
+            if (parse_value(optarg, &hz) < 0) return 1;
+            break;
+        default:
+            return 1;
+        }
+    }
+    if (argc - optind != 1 || parse_count(argv[optind], 1, MAX_GRID_X/2-2, &stages) < 0) {
+        fprintf(stderr, "stages expected\n");
+        return 1;
+    }
+
+    printf("# gen_circuit multiplier -v %Lg -f %Lg -h %Lg %d\n", volts, farads, hz, stages);
+    printf("clear_all\n\n");
+
+    // the power supply, between S(0) and P(0) at x=1
+    sprintf(power_str, "%.6Lgv,%.6Lghz", volts, hz);
+    add_comp(COMP_WIRE, 1, 1, 1, 2, 0);
+    add_power(1, 2, 1, 3, power_str);
+    add_comp(COMP_WIRE, 1, 3, 2, 3, 0);
+    add_comp(COMP_WIRE, 2, 2, 2, 3, 0);
+    printf("\n");
+
+    for (k = 1; k <= stages; k++) {
+        // pump capacitor P(k-1) to P(k), and smoothing capacitor S(k-1) to S(k)
+        add_comp(COMP_CAPACITOR, 2*k-1, 1, 2*k, 1, farads);
+        add_comp(COMP_WIRE, 2*k, 1, 2*k+1, 1, 0);
+        add_comp(COMP_CAPACITOR, 2*k, 3, 2*k+1, 3, farads);
+        add_comp(COMP_WIRE, 2*k+1, 3, 2*k+2, 3, 0);
+
+        // diodes S(k-1) to P(k), and P(k) to S(k)
+        add_comp(COMP_DIODE, 2*k, 2, 2*k+1, 2, 0);
+        add_comp(COMP_DIODE, 2*k+1, 2, 2*k+2, 2, 0);
+        add_comp(COMP_WIRE, 2*k+1, 1, 2*k+1, 2, 0);
+        add_comp(COMP_WIRE, 2*k+2, 2, 2*k+2, 3, 0);
+        printf("\n");
+    }
+
+    printf("ground %s\n\n", xy_str(2, 3));
+
+    // scopes of the supply and the output voltages
+    printf("set scope_span_t 100ms\n");
+    printf("set scope_a voltage,%Lg,%Lg,%s,%s,POWER\n", -volts, volts, xy_str(1, 2), xy_str(1, 3));
+    printf("set scope_b voltage,0,%Lg,%s,%s,OUTPUT\n", 2*stages*volts,
+           xy_str(2*stages+2, 3), xy_str(2, 3));
+
+    return 0;
+}
+
+// -----------------  UTILS  ---------------------------------------------
+
+static void add_comp(int32_t type, int32_t x0, int32_t y0, int32_t x1, int32_t y1, long double value)
+{
+    component_t c;
+
+    memset(&c,0,sizeof(c));
+    c.type = type;
+    c.type_str = comp_type_str[type];
+    c.term[0].termid = 0;
+    c.term[0].gridloc.x = x0;
+    c.term[0].gridloc.y = y0;
+    c.term[1].termid = 1;
+    c.term[1].gridloc.x = x1;
+    c.term[1].gridloc.y = y1;
+    switch (type) {
+    case COMP_RESISTOR:
+        c.resistor.ohms = value;
+        break;
+    case COMP_CAPACITOR:
+        c.capacitor.farads = value;
+        break;
+    case COMP_INDUCTOR:
+        c.inductor.henrys = value;
+        break;
+    }
+    printf("add %s\n", make_component_str(&c));
+}
+
+static void add_power(int32_t x0, int32_t y0, int32_t x1, int32_t y1, char *value_str)
+{
+    printf("add %-10s %-4s %-4s %s\n", "power", xy_str(x0,y0), xy_str(x1,y1), value_str);
+}
+
+// join the points with wires, the points are the x values of a row, or
+// the y values of a column, in order
+static void add_wire_chain(int32_t *pts, int32_t max_pts, int32_t fixed, bool fixed_is_x)
+{
+    int32_t i;
+
+    for (i = 0; i < max_pts-1; i++) {
+        if (fixed_is_x) {
+            add_comp(COMP_WIRE, fixed, pts[i], fixed, pts[i+1], 0);
+        } else {
+            add_comp(COMP_WIRE, pts[i], fixed, pts[i+1], fixed, 0);
+        }
+    }
+}
+
+// random value from min to max, with a log distribution
+static long double random_log(long double min, long double max)
+{
+    return min * powl(max / min, random() / (RAND_MAX + 1.L));
+}
+
+static int32_t parse_count(char *s, int32_t min, int32_t max, int32_t *result)
+{
+    if (sscanf(s, "%d", result) != 1 || *result < min || *result > max) {
+        fprintf(stderr, "invalid count '%s', expected %d to %d\n", s, min, max);
+        return -1;
+    }
+    return 0;
+}
+
+static int32_t parse_value(char *s, long double *result)
+{
+    if (sscanf(s, "%Lf", result) != 1 || *result <= 0) {
+        fprintf(stderr, "invalid value '%s'\n", s);
+        return -1;
+    }
+    return 0;
+}
+
+static char * xy_str(int32_t x, int32_t y)
+{
+    gridloc_t gl = {x, y};
+    return make_gridloc_str(&gl);
+}
+
+// -----------------  UTILS FROM MAIN.C  ---------------------------------
+
+static char * make_gridloc_str(gridloc_t * gl)
+{
+    #define MAX_S 32
+
+    static char static_str[MAX_S][16];
+    static int32_t static_idx;
+    int32_t idx, n, i, digit;
+    char *s, letters[8];
+
+    assert(gl->x >= 0 && gl->x < MAX_GRID_X);
+    assert(gl->y >= 0 && gl->y < MAX_GRID_Y);
+
+    idx = __sync_fetch_and_add(&static_idx,1) % MAX_S;
+    s = static_str[idx];
+
+    // the letters are the y value in bijective base 52, see gridloc_to_str
+    i = sizeof(letters) - 1;
+    letters[i] = '\0';
+    n = gl->y + 1;
+    while (n > 0) {
+        digit = (n - 1) % 52;
+        letters[--i] = (digit < 26 ? 'a' + digit : 'A' + digit - 26);
+        n = (n - 1) / 52;
+    }
+
+    sprintf(s, "%s%d", letters+i, gl->x + 1);
+
+    return s;
+}
+
+static char * make_component_str(component_t * c)
+{
+    #define MAX_S 32
+
+    static char static_str[MAX_S][100];
+    static int32_t static_idx;
+    int32_t idx;
+    char *s, *p;
+
+    idx = __sync_fetch_and_add(&static_idx,1) % MAX_S;
+    s = static_str[idx];
+
+    p = s;
+    p += sprintf(p, "%-10s %-4s %-4s",
+                 c->type_str,
+                 make_gridloc_str(&c->term[0].gridloc),
+                 make_gridloc_str(&c->term[1].gridloc));
+
+    switch (c->type) {
+    case COMP_WIRE:
+    case COMP_DIODE:
+        break;
+    case COMP_RESISTOR:
+        p += sprintf(p, " %.2Lf", c->resistor.ohms);
+        break;
+    case COMP_CAPACITOR:
+        p += sprintf(p, " %.4LgF", c->capacitor.farads);
+        break;
+    case COMP_INDUCTOR:
+        p += sprintf(p, " %.4LgH", c->inductor.henrys);
+        break;
+    default:
+        assert(0);
+    }
+
+    return s;
+}
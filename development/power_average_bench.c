@@ -0,0 +1,103 @@
+// benchmark of the windowed_average, which is used by model.c to average 
+// component power, compared with the timed_moving_average that it replaced
+//
+// usage: power_average_bench [<components> [<steps>]]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#include <util_misc.h>
+
+#define TIME_SPAN  0.1
+#define MAX_BINS   1000
+#define DELTA_T    1e-5
+
+static uint64_t microsec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// the value being averaged, a 60hz sine wave offset so that the average is 
+// 1 + idx/max_comp
+static long double watts(int32_t idx, int32_t max_comp, long double t)
+{
+    return 1 + (long double)idx / max_comp + sinl(t * 60 * (2 * M_PI));
+}
+
+int32_t main(int argc, char **argv)
+{
+    int32_t max_comp = 10000, max_step = 20000, i, j;
+    tma_t ** tma;
+    wa_t * wa;
+    long double t, max_diff;
+    uint64_t start_us, tma_us, wa_us;
+
+    if (argc > 1 && sscanf(argv[1], "%d", &max_comp) != 1) {
+        printf("usage: power_average_bench [<components> [<steps>]]\n");
+        return 1;
+    }
+    if (argc > 2 && sscanf(argv[2], "%d", &max_step) != 1) {
+        printf("usage: power_average_bench [<components> [<steps>]]\n");
+        return 1;
+    }
+
+    tma = calloc(max_comp, sizeof(tma_t *));
+    wa = calloc(max_comp, sizeof(wa_t));
+    for (i = 0; i < max_comp; i++) {
+        tma[i] = timed_moving_average_alloc(TIME_SPAN, MAX_BINS);
+        windowed_average_init(&wa[i], TIME_SPAN);
+    }
+
+    // time the timed_moving_average
+    start_us = microsec();
+    for (j = 0; j < max_step; j++) {
+        t = j * DELTA_T;
+        for (i = 0; i < max_comp; i++) {
+            timed_moving_average(watts(i,max_comp,t), t, tma[i]);
+        }
+    }
+    tma_us = microsec() - start_us;
+
+    // time the windowed_average
+    start_us = microsec();
+    for (j = 0; j < max_step; j++) {
+        t = j * DELTA_T;
+        for (i = 0; i < max_comp; i++) {
+            windowed_average(watts(i,max_comp,t), t, &wa[i]);
+        }
+    }
+    wa_us = microsec() - start_us;
+
+    // compare the results
+    max_diff = 0;
+    for (i = 0; i < max_comp; i++) {
+        long double diff = fabsl(timed_moving_average_query(tma[i]) - windowed_average_query(&wa[i]));
+        if (diff > max_diff) {
+            max_diff = diff;
+        }
+    }
+
+    printf("components=%d  steps=%d  delta_t=%g  time_span=%g\n", 
+           max_comp, max_step, DELTA_T, TIME_SPAN);
+    printf("timed_moving_average: %8zd bytes/component  %8.1f MB total  %6.1f ns/update\n",
+           sizeof(tma_t) + sizeof(ma_t) + MAX_BINS * sizeof(long double),
+           (double)max_comp * (sizeof(tma_t) + sizeof(ma_t) + MAX_BINS * sizeof(long double)) / 1e6,
+           1000. * tma_us / ((double)max_comp * max_step));
+    printf("windowed_average:     %8zd bytes/component  %8.1f MB total  %6.1f ns/update\n",
+           sizeof(wa_t),
+           (double)max_comp * sizeof(wa_t) / 1e6,
+           1000. * wa_us / ((double)max_comp * max_step));
+    printf("max difference of averages = %Lg\n", max_diff);
+
+    return 0;
+}
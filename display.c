@@ -48,6 +48,24 @@ SOFTWARE.
 #define FPSZ_SMALL         24
 #define FPSZ_SMALLER       16
 
+// schematic level of detail, when zoomed out:
+// - labels are not drawn when the font would be smaller than LOD_MIN_FPSZ
+// - components are drawn as a line between their terminals, rather than 
+//   their image, when grid_scale is less than LOD_MIN_IMAGE_SCALE; the 
+//   smallest features of the component images are then only a few pixels
+// - BLACK junction points are not drawn when grid_scale is less than
+//   LOD_MIN_JUNCTION_SCALE
+// - grid points are drawn at every Nth gridloc, so that they are spaced
+//   at least LOD_MIN_GRID_POINT_SPACING pixels apart
+#define LOD_MIN_FPSZ                10
+#define LOD_MIN_IMAGE_SCALE         100
+#define LOD_MIN_JUNCTION_SCALE      40
+#define LOD_MIN_GRID_POINT_SPACING  40
+
+// the most gridlocs that can be within the range rendered by the schematic 
+// pane, which extends one gridloc beyond each side of the pane
+#define MAX_VISIBLE_GRIDLOC ((PH_SCHEMATIC_W / MIN_GRID_SCALE + 3) * (PH_SCHEMATIC_H / MIN_GRID_SCALE + 3))
+
 //
 // typedefs
 //
@@ -58,6 +76,80 @@ typedef struct {
     gridloc_t gl1;
 } scope_select_t;
 
+typedef struct {
+    point_t   * points;      // pairs of points, the end points of each segment
+    int32_t     max;
+    int32_t     max_alloced;
+} segments_t;
+
+typedef struct {
+    texture_t   texture;
+    uint32_t  * pixels;
+    int32_t   * y_last;      // y of the last point of the trace in each column, -1 if none
+    int32_t     width;
+    int32_t     height;
+    // the texture is redrawn when any of these change
+    long double start_t;
+    long double span_t;
+    long double ymin;
+    long double ymax;
+    int32_t     color;
+    uint64_t    history_gen;
+    // the columns prior to cols_done contain final values, -1 if not yet drawn
+    int32_t     cols_done;
+} scope_trace_t;
+
+typedef struct {
+    int32_t     idx;          // index of the component, and of its values in the snapshot
+    int32_t     type;
+    bool        remote;
+    char        comp_str[16];
+    gridloc_t   gl[2];
+    int32_t     node[2];      // index of the terminals' nodes, -1 if none
+    int32_t     value_str;    // offset of the value string in frame.strs, -1 if none
+} frame_component_t;
+
+typedef struct {
+    gridloc_t   gl;
+    bool        is_ground;
+    bool        has_remote_wire;
+    int32_t     remote_wire_color;
+} frame_gridloc_t;
+
+// the circuit and params that are rendered by the panes; these are copied at the
+// start of each frame with the display lock held, see frame_copy, so that the 
+// panes are rendered without the display lock; the circuit values are from the 
+// model snapshot
+typedef struct {
+    // params
+    bool        grid;
+    bool        voltage;
+    bool        current;
+    char        component[100];
+    bool        scope_continuous;
+    long double scope_span_t;
+    bool        scope_defined[MAX_SCOPE];
+    int32_t     scope_select_idx;
+    // the range of gridlocs that are rendered, and the font size, which are 
+    // determined by the center and scale params
+    int32_t     glx_first, glx_last, gly_first, gly_last;
+    int32_t     fpsz;
+    // the components whose term[0] is within the range of gridlocs, and the
+    // gridlocs within the range that have a terminal
+    frame_component_t * comp;
+    int32_t     max_comp;
+    int32_t     max_alloced_comp;
+    frame_gridloc_t gridloc[MAX_VISIBLE_GRIDLOC];
+    int32_t     max_gridloc;
+    char      * strs;
+    int32_t     max_strs;
+    int32_t     max_alloced_strs;
+    // filenames
+    char        current_filename[200];
+    char        print_screen_filename[PATH_MAX];
+    char        record_filename[PATH_MAX+20];
+} frame_t;
+
 //
 // variables
 //
@@ -71,15 +163,37 @@ static long double  grid_scale;
 
 static scope_select_t scope_select;
 
+static model_snapshot_t snap;
+static frame_t          frame;
+
+static uint64_t cli_update_count;
+static uint64_t frame_count;
+static bool     redraw_requested;
+
+static char        print_screen_filename[PATH_MAX];
+
+static bool        record_enabled;
+static char        record_prefix[PATH_MAX];
+static char        record_ext[8];
+static int32_t     record_frame;
+static long double record_model_t;
+
 //
 // prototypes
 //
 
 static void display_start(void * cx);
 static void display_end(void * cx);
+static bool display_redraw_needed(void * cx);
+static void frame_copy(void);
+static int32_t frame_add_str(char * s);
 static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void * init, sdl_event_t * event);
 static int32_t pane_hndlr_status(pane_cx_t * pane_cx, int32_t request, void * init, sdl_event_t * event);
 static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * init, sdl_event_t * event);
+static void scope_trace_render(scope_trace_t * tr, probe_t * p, int32_t width, int32_t height,
+                               long double start_t, long double span_t, int32_t color);
+static void scope_trace_free(scope_trace_t * tr);
+static void segments_add(segments_t * segs, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 
 // -----------------  PUBLIC  ---------------------------------------------
 
@@ -99,21 +213,26 @@ void display_lock(void)
 
 void display_unlock(void)
 {
+    // the display lock is acquired by the cli while processing a command, 
+    // which may change what is displayed
+    __atomic_add_fetch(&cli_update_count, 1, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&mutex);
 }
 
-void display_handler(void)
+void display_handler(bool offscreen)
 {
-    // use sdl to display the schematic
+    // use sdl to display the schematic; when offscreen, such as in batch mode, 
+    // the display is rendered in memory and is only seen by print screen
     win_width  = DEFAULT_WIN_WIDTH;
     win_height = DEFAULT_WIN_HEIGHT;
-    if (sdl_init(&win_width, &win_height, true) < 0) {
+    if (sdl_init(&win_width, &win_height, true, offscreen) < 0) {
         FATAL("sdl_init %dx%d failed\n", win_width, win_height);
     }
     sdl_pane_manager(
         NULL,           // context
         display_start,  // called prior to pane handlers
         display_end,    // called after pane handlers
+        display_redraw_needed,  // returns true if the display needs to be redrawn
         100000,         // 0=continuous, -1=never, else us 
         3,              // number of pane handler varargs that follow
         pane_hndlr_schematic, NULL, PH_SCHEMATIC_X, PH_SCHEMATIC_Y, PH_SCHEMATIC_W, PH_SCHEMATIC_H, PANE_BORDER_STYLE_MINIMAL,
@@ -122,18 +241,294 @@ void display_handler(void)
                         );
 }
 
+// the print screen and record requests are called by the cli, with the display lock 
+// held; the display pixels are read when the display is next redrawn, by display_end,
+// because the display can only be read by the thread that renders it
+void display_print_screen(char * filename)
+{
+    if (strlen(filename) >= sizeof(print_screen_filename)) {
+        ERROR("filename too long\n");
+        return;
+    }
+    strcpy(print_screen_filename, filename);
+}
+
+int32_t display_record(char * filename)
+{
+    char *ext;
+
+    // record off
+    if (strcasecmp(filename, "off") == 0) {
+        if (record_enabled) {
+            INFO("recorded %d frames to %s_NNNNNN%s\n", record_frame, record_prefix, record_ext);
+        }
+        record_enabled = false;
+        return 0;
+    }
+
+    // record <filename.png|.jpg>; the filename's extension selects the file format,
+    // and the frame number is inserted prior to the extension
+    ext = strrchr(filename, '.');
+    if (ext == NULL || (strcmp(ext, ".png") != 0 && strcmp(ext, ".jpg") != 0)) {
+        ERROR("filename %s must have .jpg or .png extension\n", filename);
+        return -1;
+    }
+    if (ext - filename + 20 > sizeof(record_prefix)) {
+        ERROR("filename too long\n");
+        return -1;
+    }
+    memcpy(record_prefix, filename, ext - filename);
+    record_prefix[ext - filename] = '\0';
+    strcpy(record_ext, ext);
+    record_frame = 0;
+    record_model_t = -1;
+    record_enabled = true;
+    return 0;
+}
+
+// wait for the display to be redrawn, so that the display that is rendered includes
+// all changes made prior to this call; this must be called without the display lock;
+// returns -1 if the display is not redrawn within 5 secs
+int32_t display_sync(void)
+{
+    uint64_t target_frame_count;
+    uint64_t start_us = microsec_timer();
+
+    // the frame that is being rendered when this is called may have been started 
+    // prior to the call, so wait for the frame that follows it
+    target_frame_count = __atomic_load_n(&frame_count, __ATOMIC_ACQUIRE) + 2;
+    __atomic_store_n(&redraw_requested, true, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&frame_count, __ATOMIC_ACQUIRE) < target_frame_count) {
+        if (microsec_timer() - start_us > 5000000) {
+            ERROR("timed out waiting for display\n");
+            return -1;
+        }
+        usleep(10000);
+    }
+    return 0;
+}
+
 // -----------------  DISPLAY HANDLER SUPPORT -----------------------------
 
 static void display_start(void * cx)
 {
-    // acquire display lock at the start of redrawing the display
-    display_lock();
+    // get the snapshot of the circuit values published by the model_thread,
+    // the voltages, currents, and model time are displayed from this
+    // snapshot rather than from the node and component values that the
+    // model_thread is updating
+    model_get_snapshot(&snap);
+
+    // acquire the display lock just long enough to copy the circuit and params
+    // that are rendered, so that the cli is not blocked while the frame is 
+    // being rendered
+    pthread_mutex_lock(&mutex);
+    frame_copy();
+    pthread_mutex_unlock(&mutex);
 }
 
 static void display_end(void * cx)
 {
-    // release the display lock when done redrawing the display
-    display_unlock();
+    char filename[PATH_MAX+20];
+
+    // if print screen has been requested then print the display that
+    // has just been rendered
+    if (frame.print_screen_filename[0] != '\0') {
+        sdl_print_screen(frame.print_screen_filename, false, NULL);
+    }
+
+    // if recording then print the display to the next file of the sequence;
+    // if the encoder threads are busy then the frame is skipped; the sequence 
+    // is advanced unless the cli has turned recording off or restarted it
+    // while the frame was rendered
+    if (frame.record_filename[0] != '\0' && 
+        sdl_print_screen(frame.record_filename, false, NULL) == 0) 
+    {
+        pthread_mutex_lock(&mutex);
+        sprintf(filename, "%s_%6.6d%s", record_prefix, record_frame, record_ext);
+        if (record_enabled && strcmp(filename, frame.record_filename) == 0) {
+            record_frame++;
+            record_model_t = snap.model_t;
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    __atomic_add_fetch(&frame_count, 1, __ATOMIC_RELEASE);
+}
+
+static bool display_redraw_needed(void * cx)
+{
+    #define MAX_REDRAW_INTERVAL_US 1000000
+
+    static uint64_t last_model_count, last_param_count, last_cli_count, last_redraw_us;
+    uint64_t model_count, param_count, cli_count, now_us;
+    int32_t id;
+    bool redraw;
+
+    // the display needs to be redrawn when the model has advanced or changed 
+    // state, or a param has changed, or the cli has processed a command, 
+    // or display_sync has requested it; and also once per second
+    model_count = model_update_count();
+    cli_count = __atomic_load_n(&cli_update_count, __ATOMIC_RELAXED);
+    param_count = 0;
+    for (id = 0; id < PARAM_SCOPE_A+MAX_SCOPE; id++) {
+        param_count += param_update_count(id);
+    }
+    now_us = microsec_timer();
+
+    redraw = (__atomic_exchange_n(&redraw_requested, false, __ATOMIC_ACQ_REL) ||
+              model_count != last_model_count ||
+              param_count != last_param_count ||
+              cli_count != last_cli_count ||
+              now_us - last_redraw_us >= MAX_REDRAW_INTERVAL_US);
+
+    if (redraw) {
+        last_model_count = model_count;
+        last_param_count = param_count;
+        last_cli_count = cli_count;
+        last_redraw_us = now_us;
+    }
+    return redraw;
+}
+
+// copy the circuit and params that are rendered to the frame; this is called
+// with the display lock held
+static void frame_copy(void)
+{
+    int32_t j, x_min, x_max, y_min, y_max;
+    gridloc_t gl, root, ground_root = {-1,-1};
+    grid_t *g;
+    component_t *c;
+    frame_component_t *fc;
+    frame_gridloc_t *fg;
+    bool copy_values;
+    char s[300];
+
+    // params
+    frame.grid = (strcasecmp(param_str_val(PARAM_GRID), "on") == 0);
+    frame.voltage = (strcasecmp(param_str_val(PARAM_VOLTAGE), "on") == 0);
+    frame.current = (strcasecmp(param_str_val(PARAM_CURRENT), "on") == 0);
+    snprintf(frame.component, sizeof(frame.component), "%s", param_str_val(PARAM_COMPONENT));
+    frame.scope_continuous = (strcasecmp(param_str_val(PARAM_SCOPE_MODE), "continuous") == 0);
+    frame.scope_span_t = param_num_val(PARAM_SCOPE_SPAN_T);
+    for (j = 0; j < MAX_SCOPE; j++) {
+        frame.scope_defined[j] = (strncasecmp(param_str_val(PARAM_SCOPE_A+j), "off", 3) != 0);
+    }
+    frame.scope_select_idx = scope_select_idx;
+
+    // filenames; a print screen request is done once, by this frame
+    strcpy(frame.current_filename, current_filename);
+    strcpy(frame.print_screen_filename, print_screen_filename);
+    print_screen_filename[0] = '\0';
+    frame.record_filename[0] = '\0';
+    if (record_enabled && snap.model_t != record_model_t) {
+        sprintf(frame.record_filename, "%s_%6.6d%s", record_prefix, record_frame, record_ext);
+    }
+
+    // determine grid_xoff, grid_yoff, grid_scale from
+    // PARAM_CENTER, PARAM_SCALE
+    {
+    int32_t xadj=0, yadj=0;
+    char *p;
+
+    str_to_gridloc(param_str_val(PARAM_CENTER), &gl);
+    if ((p = strchr(param_str_val(PARAM_CENTER), ',')) != NULL) {
+        sscanf(p+1, "%d,%d", &xadj, &yadj);
+    }
+
+    // the scale is clamped to the range allowed by param_set, which the
+    // size of the gridloc array is based on
+    grid_scale = param_num_val(PARAM_SCALE);
+    if (grid_scale < MIN_GRID_SCALE) grid_scale = MIN_GRID_SCALE;
+    if (grid_scale > MAX_GRID_SCALE) grid_scale = MAX_GRID_SCALE;
+    grid_xoff = -grid_scale * gl.x + PH_SCHEMATIC_W/2 - xadj * grid_scale / 1000;
+    grid_yoff = -grid_scale * gl.y + PH_SCHEMATIC_H/2 - yadj * grid_scale / 1000;
+    }
+
+    // determine the range of gridlocs that are rendered, these are within 
+    // a grid_scale of the schematic pane
+    x_min = -grid_scale;                  
+    x_max = PH_SCHEMATIC_W + grid_scale; 
+    y_min = -grid_scale;                
+    y_max = PH_SCHEMATIC_H + grid_scale;
+    frame.glx_first = ceill((x_min - grid_xoff) / grid_scale);
+    frame.glx_last  = floorl((x_max - grid_xoff) / grid_scale);
+    frame.gly_first = ceill((y_min - grid_yoff) / grid_scale);
+    frame.gly_last  = floorl((y_max - grid_yoff) / grid_scale);
+    if (frame.glx_first < 0) frame.glx_first = 0;
+    if (frame.glx_last > MAX_GRID_X-1) frame.glx_last = MAX_GRID_X-1;
+    if (frame.gly_first < 0) frame.gly_first = 0;
+    if (frame.gly_last > MAX_GRID_Y-1) frame.gly_last = MAX_GRID_Y-1;
+
+    // select font point size based on grid_scale
+    frame.fpsz = grid_scale * 40 / MAX_GRID_SCALE;
+
+    // copy the visible components and the gridlocs that have a terminal; the 
+    // grid's terminal lists are used as a spatial index, a component is visible 
+    // when its term[0] is within the range of gridlocs determined above; the
+    // value strings are only made when they will be displayed
+    copy_values = (frame.fpsz >= LOD_MIN_FPSZ && strcasecmp(frame.component, "value") == 0);
+    if (ground_is_set) {
+        ground_root = grid_find(ground);
+    }
+    frame.max_comp = 0;
+    frame.max_gridloc = 0;
+    frame.max_strs = 0;
+    for (gl.x = frame.glx_first; gl.x <= frame.glx_last; gl.x++) {
+        for (gl.y = frame.gly_first; gl.y <= frame.gly_last; gl.y++) {
+            g = grid_get(&gl);
+            if (g == NULL || g->max_term == 0) {
+                continue;
+            }
+
+            for (j = 0; j < g->max_term; j++) {
+                if (g->term[j]->termid != 0) {
+                    continue;
+                }
+                if (frame.max_comp == frame.max_alloced_comp) {
+                    frame.max_alloced_comp = (frame.max_alloced_comp ? 2 * frame.max_alloced_comp : 1000);
+                    frame.comp = realloc(frame.comp, frame.max_alloced_comp * sizeof(frame_component_t));
+                    assert(frame.comp);
+                }
+                c = g->term[j]->component;
+                fc = &frame.comp[frame.max_comp++];
+                fc->idx       = c - component;
+                fc->type      = c->type;
+                fc->remote    = (c->type == COMP_WIRE && c->wire.remote);
+                strcpy(fc->comp_str, c->comp_str);
+                fc->gl[0]     = c->term[0].gridloc;
+                fc->gl[1]     = c->term[1].gridloc;
+                fc->node[0]   = (c->term[0].node ? c->term[0].node - node : -1);
+                fc->node[1]   = (c->term[1].node ? c->term[1].node - node : -1);
+                fc->value_str = (copy_values && c->type != COMP_NONE
+                                 ? frame_add_str(component_to_value_str(c,s,sizeof(s))) : -1);
+            }
+
+            // the grid location is ground if it is connected to the ground by wires
+            assert(frame.max_gridloc < MAX_VISIBLE_GRIDLOC);
+            root = grid_find(gl);
+            fg = &frame.gridloc[frame.max_gridloc++];
+            fg->gl = gl;
+            fg->is_ground = (root.x == ground_root.x && root.y == ground_root.y);
+            fg->has_remote_wire = g->has_remote_wire;
+            fg->remote_wire_color = g->remote_wire_color;
+        }
+    }
+}
+
+// append a string to the frame's strings, and return its offset
+static int32_t frame_add_str(char * s)
+{
+    int32_t len = strlen(s) + 1;
+    int32_t offset = frame.max_strs;
+
+    if (frame.max_strs + len > frame.max_alloced_strs) {
+        frame.max_alloced_strs = frame.max_alloced_strs * 2 + len + 10000;
+        frame.strs = realloc(frame.strs, frame.max_alloced_strs);
+        assert(frame.strs);
+    }
+    memcpy(frame.strs + offset, s, len);
+    frame.max_strs += len;
+    return offset;
 }
 
 // -----------------  PANE HNDLR SCHEMATIC  -------------------------------
@@ -192,7 +587,7 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
             { {-1,-1} } } };
 
     struct {
-        int32_t nothing;
+        segments_t segs[2];
     } * vars = pane_cx->vars;
     rect_t * pane = &pane_cx->pane;
 
@@ -211,26 +606,14 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
 
     if (request == PANE_HANDLER_REQ_RENDER) {
         int32_t x_min, x_max, y_min, y_max;
+        int32_t glx_first, glx_last, gly_first, gly_last;
         int32_t fpsz;
-        bool    display_intermediate_values;
         int32_t large_point_size, small_point_size;
+        bool    lod_labels, lod_images, lod_junctions;
+        int32_t lod_grid_step;
 
-        // determine grid_xoff, grid_yoff, grid_scale from
-        // PARAM_CENTER, PARAM_SCALE
-        {
-        gridloc_t gl;
-        int32_t xadj=0, yadj=0;
-        char *p;
-
-        str_to_gridloc(param_str_val(PARAM_CENTER), &gl);
-        if ((p = strchr(param_str_val(PARAM_CENTER), ',')) != NULL) {
-            sscanf(p+1, "%d,%d", &xadj, &yadj);
-        }
-
-        grid_scale = param_num_val(PARAM_SCALE);
-        grid_xoff = -grid_scale * gl.x + PH_SCHEMATIC_W/2 - xadj * grid_scale / 1000;
-        grid_yoff = -grid_scale * gl.y + PH_SCHEMATIC_H/2 - yadj * grid_scale / 1000;
-        }
+        // the grid_xoff, grid_yoff, grid_scale, and the range of gridlocs that
+        // are rendered have been determined by frame_copy
 
         // initialize range of x,y that will be rendered by the 
         // the subsequent code; these variables are used by the OUT_OF_PANE macro
@@ -238,9 +621,11 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
         x_max = PH_SCHEMATIC_W + grid_scale; 
         y_min = -grid_scale;                
         y_max = PH_SCHEMATIC_H + grid_scale;
-
-        // select font point size based on grid_scale
-        fpsz = grid_scale * 40 / MAX_GRID_SCALE;
+        glx_first = frame.glx_first;
+        glx_last  = frame.glx_last;
+        gly_first = frame.gly_first;
+        gly_last  = frame.gly_last;
+        fpsz      = frame.fpsz;
 
         // determine the size of the large and small points,
         // the largest size currently supported by util_sdl is 9
@@ -252,38 +637,43 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
         if (large_point_size < 6) large_point_size = 6;
         small_point_size = large_point_size - 3;
 
-        // determine whether intermediate voltage and current values will be displayed
-        // - normally the intermediate values should not be displayed;
-        // - intermediate values are the values that are computed by the model during the 
-        //   circuit evaluation before the evaluation stabilizes at the values that allow
-        //   the model to proceed to the next time;
-        // - displaying intermediate values is useful when evaluating the resistor grid, 
-        //   to watch the progression prior to the resistor grid evaluation stabilizing
-        display_intermediate_values = (strcasecmp(param_str_val(PARAM_INTERMEDIATE), "on") == 0);
+        // determine the level of detail to be drawn, based on grid_scale
+        lod_labels    = (fpsz >= LOD_MIN_FPSZ);
+        lod_images    = (grid_scale >= LOD_MIN_IMAGE_SCALE);
+        lod_junctions = (grid_scale >= LOD_MIN_JUNCTION_SCALE);
+        lod_grid_step = ceill(LOD_MIN_GRID_POINT_SPACING / grid_scale);
+        if (lod_grid_step < 1) lod_grid_step = 1;
 
         // draw grid, if enabled
-        if (strcasecmp(param_str_val(PARAM_GRID), "on") == 0) {
+        if (frame.grid) {
             int32_t glx, gly, x, y, count=0;
-            point_t points[MAX_GRID_X*MAX_GRID_Y];
+            point_t points[MAX_VISIBLE_GRIDLOC];
+            gridloc_t gl;
+            char s[50];
 
             // draw gridloc_str at each grid point
-            for (glx = 0; glx < MAX_GRID_X; glx++) {
-                for (gly = 0; gly < MAX_GRID_Y; gly++) {
+            for (glx = glx_first; glx <= glx_last && lod_labels; glx++) {
+                for (gly = gly_first; gly <= gly_last; gly++) {
                     x = glx * grid_scale + grid_xoff + 2;
                     y = gly * grid_scale + grid_yoff - 2 - sdl_font_char_height(fpsz);
                     if (OUT_OF_PANE(x,y)) {
                         continue;
                     }
-                    sdl_render_printf(pane, x, y, fpsz, BLUE, WHITE, "%s", grid[glx][gly].glstr);
+                    gl.x = glx;
+                    gl.y = gly;
+                    sdl_render_printf(pane, x, y, fpsz, BLUE, WHITE, "%s", gridloc_to_str(&gl,s));
                 }
             }
 
             // draw grid points
-            for (glx = 0; glx < MAX_GRID_X; glx++) {
-                for (gly = 0; gly < MAX_GRID_Y; gly++) {
+            for (glx = glx_first; glx <= glx_last; glx++) {
+                for (gly = gly_first; gly <= gly_last; gly++) {
+                    if ((glx % lod_grid_step) || (gly % lod_grid_step)) {
+                        continue;
+                    }
                     x = glx * grid_scale + grid_xoff;
                     y = gly * grid_scale + grid_yoff;
-                    if (OUT_OF_PANE(x,y)) {
+                    if (OUT_OF_PANE(x,y) || count == MAX_VISIBLE_GRIDLOC) {
                         continue;
                     }
                     points[count].x = x;
@@ -294,37 +684,41 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
             sdl_render_points(pane, points, count, BLUE, small_point_size);
         }
 
-        // draw schematic components
-        { int32_t i;
-        for (i = 0; i < max_component; i++) {
-            component_t * c  = &component[i];
-            int32_t color;
+        // draw schematic components; the line segments of the components are
+        // collected, in segs[0] for BLACK and segs[1] for BLUE, and rendered 
+        // together after this loop
+        { int32_t v;
+          segments_t *segs;
+        vars->segs[0].max = 0;
+        vars->segs[1].max = 0;
+        for (v = 0; v < frame.max_comp; v++) {
+            frame_component_t * c = &frame.comp[v];
 
             // if the component is the selected scope then display the component
             // in BLUE, else BLACK
             if ((scope_select.enabled) &&
-                ((memcmp(&c->term[0].gridloc, &scope_select.gl0, sizeof(gridloc_t)) == 0 &&
-                  memcmp(&c->term[1].gridloc, &scope_select.gl1, sizeof(gridloc_t)) == 0) ||
-                 (memcmp(&c->term[0].gridloc, &scope_select.gl1, sizeof(gridloc_t)) == 0 &&
-                  memcmp(&c->term[1].gridloc, &scope_select.gl0, sizeof(gridloc_t)) == 0)))
+                ((memcmp(&c->gl[0], &scope_select.gl0, sizeof(gridloc_t)) == 0 &&
+                  memcmp(&c->gl[1], &scope_select.gl1, sizeof(gridloc_t)) == 0) ||
+                 (memcmp(&c->gl[0], &scope_select.gl1, sizeof(gridloc_t)) == 0 &&
+                  memcmp(&c->gl[1], &scope_select.gl0, sizeof(gridloc_t)) == 0)))
             {
-                color = BLUE;
+                segs = &vars->segs[1];
             } else {
-                color = BLACK;
+                segs = &vars->segs[0];
             }
 
             // draw the component 
             switch (c->type) {
             case COMP_WIRE: {
-                if (c->wire.remote == false) {
-                    int32_t x1 = c->term[0].gridloc.x * grid_scale + grid_xoff;
-                    int32_t y1 = c->term[0].gridloc.y * grid_scale + grid_yoff;
-                    int32_t x2 = c->term[1].gridloc.x * grid_scale + grid_xoff;
-                    int32_t y2 = c->term[1].gridloc.y * grid_scale + grid_yoff;
+                if (!c->remote) {
+                    int32_t x1 = c->gl[0].x * grid_scale + grid_xoff;
+                    int32_t y1 = c->gl[0].y * grid_scale + grid_yoff;
+                    int32_t x2 = c->gl[1].x * grid_scale + grid_xoff;
+                    int32_t y2 = c->gl[1].y * grid_scale + grid_yoff;
                     if (OUT_OF_PANE(x1,y1) || OUT_OF_PANE(x2,y2)) {
                         continue;
                     }
-                    sdl_render_line(pane, x1, y1, x2, y2, color);
+                    segments_add(segs, x1, y1, x2, y2);
                 }
                 break; }
             case COMP_POWER:
@@ -336,12 +730,20 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
                 int32_t x, y, j, k;
                 point_t points[100];
 
-                x = c->term[0].gridloc.x * grid_scale + grid_xoff;
-                y = c->term[0].gridloc.y * grid_scale + grid_yoff;
+                x = c->gl[0].x * grid_scale + grid_xoff;
+                y = c->gl[0].y * grid_scale + grid_yoff;
                 if (OUT_OF_PANE(x,y)) {
                     continue;
                 }
 
+                // when zoomed out, draw the component as a line 
+                if (!lod_images) {
+                    segments_add(segs, x, y,
+                                 c->gl[1].x * grid_scale + grid_xoff,
+                                 c->gl[1].y * grid_scale + grid_yoff);
+                    break;
+                }
+
                 if (c->type == COMP_POWER) {
                     ci = &power_image;
                 } else if (c->type == COMP_RESISTOR) {
@@ -357,27 +759,29 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
                 }
                 for (j = 0; ci->points[j][0].x != -1; j++) {
                     for (k = 0; ci->points[j][k].x != -1; k++) {
-                        if (c->term[1].gridloc.x == c->term[0].gridloc.x + 1) {
+                        if (c->gl[1].x == c->gl[0].x + 1) {
                             points[k].x = x + ci->points[j][k].x * grid_scale / 1000;  // right
                             points[k].y = y + ci->points[j][k].y * grid_scale / 1000;
-                        } else if (c->term[1].gridloc.x == c->term[0].gridloc.x - 1) {
+                        } else if (c->gl[1].x == c->gl[0].x - 1) {
                             points[k].x = x - ci->points[j][k].x * grid_scale / 1000;  // leftt
                             points[k].y = y + ci->points[j][k].y * grid_scale / 1000;
-                        } else if (c->term[1].gridloc.y == c->term[0].gridloc.y + 1) {
+                        } else if (c->gl[1].y == c->gl[0].y + 1) {
                             points[k].x = x + ci->points[j][k].y * grid_scale / 1000;  // down
                             points[k].y = y + ci->points[j][k].x * grid_scale / 1000; 
-                        } else if (c->term[1].gridloc.y == c->term[0].gridloc.y - 1) {
+                        } else if (c->gl[1].y == c->gl[0].y - 1) {
                             points[k].x = x + ci->points[j][k].y * grid_scale / 1000;  // up
                             points[k].y = y - ci->points[j][k].x * grid_scale / 1000; 
                         } else {
                             char s0[10], s1[10];
                             FATAL("component %s incorrect term locations %s %s\n",
                                   c->comp_str, 
-                                  gridloc_to_str(&c->term[0].gridloc,s0),
-                                  gridloc_to_str(&c->term[1].gridloc,s1));
+                                  gridloc_to_str(&c->gl[0],s0),
+                                  gridloc_to_str(&c->gl[1],s1));
+                        }
+                        if (k > 0) {
+                            segments_add(segs, points[k-1].x, points[k-1].y, points[k].x, points[k].y);
                         }
                     }
-                    sdl_render_lines(pane, points, k, color);
                 }
                 break; }
             case COMP_NONE:
@@ -386,37 +790,41 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
                 FATAL("invalid component type %d\n", c->type);
                 break;
             }
-        } }
+        }
+        sdl_render_line_segments(pane, vars->segs[0].points, vars->segs[0].max, BLACK);
+        sdl_render_line_segments(pane, vars->segs[1].points, vars->segs[1].max, BLUE);
+        }
 
         // display component id or value or power, if enabled
-        if (strcasecmp(param_str_val(PARAM_COMPONENT), "id") == 0 ||
-            strcasecmp(param_str_val(PARAM_COMPONENT), "value") == 0 ||
-            strcasecmp(param_str_val(PARAM_COMPONENT), "power") == 0)
+        if (lod_labels &&
+            (strcasecmp(frame.component, "id") == 0 ||
+             strcasecmp(frame.component, "value") == 0 ||
+             strcasecmp(frame.component, "power") == 0))
         {
-            int32_t i, x, y;
+            int32_t v, x, y;
             char *s, s1[100];
-            component_t *c;
+            frame_component_t *c;
 
-            for (i = 0; i < max_component; i++) {
-                c = &component[i];
+            for (v = 0; v < frame.max_comp; v++) {
+                c = &frame.comp[v];
                 if (c->type == COMP_NONE) {
                     continue;
                 }
 
-                x = c->term[0].gridloc.x * grid_scale + grid_xoff;
-                y = c->term[0].gridloc.y * grid_scale + grid_yoff;
+                x = c->gl[0].x * grid_scale + grid_xoff;
+                y = c->gl[0].y * grid_scale + grid_yoff;
                 if (OUT_OF_PANE(x,y)) {
                     continue;
                 }
 
-                if (strcasecmp(param_str_val(PARAM_COMPONENT), "id") == 0) {
+                if (strcasecmp(frame.component, "id") == 0) {
                     s = c->comp_str;
-                } else if (strcasecmp(param_str_val(PARAM_COMPONENT), "value") == 0) {
-                    s = component_to_value_str(c,s1);
+                } else if (strcasecmp(frame.component, "value") == 0) {
+                    s = (c->value_str != -1 ? frame.strs + c->value_str : "");
                 } else {  // must be "power"
                     s = "";
-                    if (c->watts && c->type != COMP_CAPACITOR && c->type != COMP_INDUCTOR) {
-                        long double watts = timed_moving_average_query(c->watts);
+                    if (c->type != COMP_CAPACITOR && c->type != COMP_INDUCTOR) {
+                        long double watts = (c->idx < snap.max_component ? snap.watts[c->idx] : NAN);
                         s = isnan(watts) ? "" : val_to_str(watts,UNITS_WATTS,s1,false);
                     }
                 }
@@ -425,16 +833,16 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
                     continue;
                 }
 
-                if (c->term[1].gridloc.x == c->term[0].gridloc.x + 1) {         // right
+                if (c->gl[1].x == c->gl[0].x + 1) {         // right
                     x += grid_scale / 2 - strlen(s) * sdl_font_char_width(fpsz) / 2;
                     y -= 2 * sdl_font_char_height(fpsz);
-                } else if (c->term[1].gridloc.x == c->term[0].gridloc.x - 1) {  // left
+                } else if (c->gl[1].x == c->gl[0].x - 1) {  // left
                     x -= grid_scale / 2 + strlen(s) * sdl_font_char_width(fpsz) / 2;
                     y -= 2 * sdl_font_char_height(fpsz);
-                } else if (c->term[1].gridloc.y == c->term[0].gridloc.y + 1) {  // down 
+                } else if (c->gl[1].y == c->gl[0].y + 1) {  // down 
                     x += 2 * sdl_font_char_width(fpsz);
                     y += grid_scale / 2 - sdl_font_char_height(fpsz) / 2;
-                } else if (c->term[1].gridloc.y == c->term[0].gridloc.y - 1) {  // up
+                } else if (c->gl[1].y == c->gl[0].y - 1) {  // up
                     x += 2 * sdl_font_char_width(fpsz);
                     y -= grid_scale / 2 + sdl_font_char_height(fpsz) / 2;
                 } else {
@@ -447,35 +855,30 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
         } 
 
         // display the voltage at all node gridlocs;
-        if (strcasecmp(param_str_val(PARAM_GRID), "off") == 0 &&
-            strcasecmp(param_str_val(PARAM_VOLTAGE), "on") == 0) 
-        {
-            int32_t i, j, x, y;
-            component_t *c;
-            terminal_t *term;
-            node_t *n;
+        if (lod_labels && !frame.grid && frame.voltage) {
+            int32_t v, j, n, x, y;
+            frame_component_t *c;
             char s[100];
             long double voltage;
 
-            for (i = 0; i < max_component; i++) {
-                c  = &component[i];
+            for (v = 0; v < frame.max_comp; v++) {
+                c = &frame.comp[v];
                 if (c->type == COMP_NONE || c->type == COMP_WIRE) {
                     continue;
                 }
                 for (j = 0; j < 2; j++) {
-                    term = &c->term[j];
-                    n = term->node;
-                    if (n == NULL) {
+                    n = c->node[j];
+                    if (n == -1 || n >= snap.max_node) {
                         continue;
                     }
 
-                    x = term->gridloc.x * grid_scale + grid_xoff + 2;
-                    y = term->gridloc.y * grid_scale + grid_yoff - 2 - sdl_font_char_height(fpsz);
+                    x = c->gl[j].x * grid_scale + grid_xoff + 2;
+                    y = c->gl[j].y * grid_scale + grid_yoff - 2 - sdl_font_char_height(fpsz);
                     if (OUT_OF_PANE(x,y)) {
                         continue;
                     }
 
-                    voltage = (display_intermediate_values ? n->v_next : n->v_now);
+                    voltage = snap.v[n];
                     val_to_str(voltage, UNITS_VOLTS, s, false);
                     sdl_render_printf(pane, x, y, fpsz, BLACK, WHITE, "%s", s);
                 }
@@ -483,55 +886,55 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
         }
 
         // display current for all components, if enabled
-        if (strcasecmp(param_str_val(PARAM_CURRENT), "on") == 0) {
-            int32_t i, x, y;
-            component_t *c;
+        if (lod_labels && frame.current) {
+            int32_t v, x, y;
+            frame_component_t *c;
             long double current;
             char current_str[100], *pre_str, *post_str;
 
-            for (i = 0; i < max_component; i++) {
-                c  = &component[i];
+            for (v = 0; v < frame.max_comp; v++) {
+                c = &frame.comp[v];
                 if (c->type == COMP_NONE || c->type == COMP_WIRE) {
                     continue;
                 }
 
-                if (c->term[0].node == NULL || c->term[1].node == NULL) {
+                if (c->node[0] == -1 || c->node[1] == -1 || c->idx >= snap.max_component) {
                     continue;
                 }
 
-                x = c->term[0].gridloc.x * grid_scale + grid_xoff;
-                y = c->term[0].gridloc.y * grid_scale + grid_yoff;
+                x = c->gl[0].x * grid_scale + grid_xoff;
+                y = c->gl[0].y * grid_scale + grid_yoff;
                 if (OUT_OF_PANE(x,y)) {
                     continue;
                 }
 
-                current = (display_intermediate_values ? c->i_next : c->i_now);
+                current = snap.i[c->idx];
                 val_to_str(fabsl(current), UNITS_AMPS, current_str, false);
                 pre_str = "";
                 post_str = "";
 
-                if (c->term[1].gridloc.x == c->term[0].gridloc.x + 1) {         // right
+                if (c->gl[1].x == c->gl[0].x + 1) {         // right
                     if (strcasecmp(current_str, "0A")) {
                         if (current > 0) post_str = " >";
                         else if (current < 0) pre_str = "< ";
                     }
                     x += grid_scale / 2 - (strlen(current_str)+2) * sdl_font_char_width(fpsz) / 2;
                     y += 1 * sdl_font_char_height(fpsz);
-                } else if (c->term[1].gridloc.x == c->term[0].gridloc.x - 1) {  // left
+                } else if (c->gl[1].x == c->gl[0].x - 1) {  // left
                     if (strcasecmp(current_str, "0A")) {
                         if (current > 0) pre_str = "< ";
                         else if (current < 0) post_str = " >";
                     }
                     x -= grid_scale / 2 + (strlen(current_str)+2) * sdl_font_char_width(fpsz) / 2;
                     y += 1 * sdl_font_char_height(fpsz);
-                } else if (c->term[1].gridloc.y == c->term[0].gridloc.y + 1) {  // down 
+                } else if (c->gl[1].y == c->gl[0].y + 1) {  // down 
                     if (strcasecmp(current_str, "0A")) {
                         if (current > 0) pre_str = "v ";
                         else if (current < 0) pre_str = "^ ";
                     }
                     x += 2 * sdl_font_char_width(fpsz);
                     y += grid_scale / 2 - sdl_font_char_height(fpsz) / 2 - 2 * sdl_font_char_height(fpsz);
-                } else if (c->term[1].gridloc.y == c->term[0].gridloc.y - 1) {  // up
+                } else if (c->gl[1].y == c->gl[0].y - 1) {  // up
                     if (strcasecmp(current_str, "0A")) {
                         if (current > 0) pre_str = "^ ";
                         else if (current < 0) pre_str = "v ";
@@ -564,39 +967,44 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
         // - remote_wire : the color assigned to the remote wire
         // - otherwise   : BLACK
         // if a grid location is both ground and remote-wire then alternate the color
-        { int32_t glx, gly, color, x, y;
-          grid_t *g;
-          static int32_t count;
-        count++;
-        for (glx = 0; glx < MAX_GRID_X; glx++) {
-            for (gly = 0; gly < MAX_GRID_Y; gly++) {
-                g = &grid[glx][gly];
-
-                if (g->max_term == 0) {
-                    continue;
-                }
+        // the BLACK points, which are most of them, are rendered together
+        { int32_t v, color, x, y, max_points=0;
+          frame_gridloc_t *fg;
+          point_t points[MAX_VISIBLE_GRIDLOC];
+          bool blink = (microsec_timer() / 1000000) & 1;
+        for (v = 0; v < frame.max_gridloc; v++) {
+            fg = &frame.gridloc[v];
+            x = fg->gl.x * grid_scale + grid_xoff;
+            y = fg->gl.y * grid_scale + grid_yoff;
+            if (OUT_OF_PANE(x,y)) {
+                continue;
+            }
 
-                x = glx * grid_scale + grid_xoff;
-                y = gly * grid_scale + grid_yoff;
-                if (OUT_OF_PANE(x,y)) {
+            // alternate color if ground and remote
+            color = (fg->has_remote_wire && fg->is_ground && blink            ? GREEN :
+                     fg->has_remote_wire                                      ? fg->remote_wire_color :
+                     fg->is_ground                                            ? GREEN 
+                                                                              : BLACK);
+            if (color == BLACK) {
+                if (!lod_junctions || max_points == MAX_VISIBLE_GRIDLOC) {
                     continue;
                 }
-
-                // alternate color if ground and remote
-                color = (g->has_remote_wire && g->ground && (count % 20 < 10) ? GREEN :
-                         g->has_remote_wire                                   ? g->remote_wire_color :
-                         g->ground                                            ? GREEN 
-                                                                              : BLACK);
+                points[max_points].x = x;
+                points[max_points].y = y;
+                max_points++;
+            } else {
                 sdl_render_point(pane, x, y, color, small_point_size);
             }
-        } }
+        }
+        sdl_render_points(pane, points, max_points, BLACK, small_point_size);
+        }
 
         // if there is a current_filename then display it, top center
-        { int32_t len = strlen(current_filename);
+        { int32_t len = strlen(frame.current_filename);
         if (len > 0) {
             int32_t x = pane->w/2 - len*sdl_font_char_width(FPSZ_MEDIUM)/2;
             if (x < 0) x = 0;
-            sdl_render_printf(pane, x, 0, FPSZ_MEDIUM, BLACK, WHITE, "%s", current_filename);
+            sdl_render_printf(pane, x, 0, FPSZ_MEDIUM, BLACK, WHITE, "%s", frame.current_filename);
         } }
 
         // register for mouse motion and mouse wheel events
@@ -630,7 +1038,7 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
             if (gl.x < 0) gl.x = 0;
             if (gl.x >= MAX_GRID_X) gl.x = MAX_GRID_X-1;
             if (gl.y < 0) gl.y = 0;
-            if (gl.y >= MAX_GRID_X) gl.y = MAX_GRID_Y-1;
+            if (gl.y >= MAX_GRID_Y) gl.y = MAX_GRID_Y-1;
 
             // determine xadj/yadj which is the difference between the new_grid_xoff/yoff and
             // the nearest gridloc; an xadj/yadj value of 1000 will move the center to the
@@ -677,6 +1085,8 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
     // ---------------------------
 
     if (request == PANE_HANDLER_REQ_TERMINATE) {
+        free(vars->segs[0].points);
+        free(vars->segs[1].points);
         free(vars);
         return PANE_HANDLER_RET_NO_ACTION;
     }
@@ -686,6 +1096,22 @@ static int32_t pane_hndlr_schematic(pane_cx_t * pane_cx, int32_t request, void *
     return PANE_HANDLER_RET_NO_ACTION;
 }
 
+// -----------------  SCHEMATIC SUPPORT  ----------------------------------
+
+static void segments_add(segments_t * segs, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    if (segs->max + 2 > segs->max_alloced) {
+        segs->max_alloced = segs->max_alloced * 2 + 1000;
+        segs->points = realloc(segs->points, segs->max_alloced * sizeof(point_t));
+        assert(segs->points);
+    }
+    segs->points[segs->max].x = x1;
+    segs->points[segs->max].y = y1;
+    segs->points[segs->max+1].x = x2;
+    segs->points[segs->max+1].y = y2;
+    segs->max += 2;
+}
+
 // -----------------  PANE HNDLR STATUS  ----------------------------------
 
 static int32_t pane_hndlr_status(pane_cx_t * pane_cx, int32_t request, void * init, sdl_event_t * event) 
@@ -697,7 +1123,9 @@ static int32_t pane_hndlr_status(pane_cx_t * pane_cx, int32_t request, void * in
     #define SDL_EVENT_MODEL_STEP   (SDL_EVENT_USER_DEFINED + 14)
 
     struct {
-        int32_t none;
+        uint64_t rate_us;
+        uint64_t rate_total_steps;
+        double   steps_per_sec;
     } * vars = pane_cx->vars;
     rect_t * pane = &pane_cx->pane;
 
@@ -716,37 +1144,63 @@ static int32_t pane_hndlr_status(pane_cx_t * pane_cx, int32_t request, void * in
 
     if (request == PANE_HANDLER_REQ_RENDER) {
         char s[100];
+        uint64_t now_us;
 
         // state and time
         sdl_render_printf(pane, 0, ROW2Y(0,FPSZ_MEDIUM), FPSZ_MEDIUM, BLACK, WHITE, 
                           "%-8s %s", 
-                          MODEL_STATE_STR(model_state),
-                          val_to_str(model_t, UNITS_SECONDS, s, false));
+                          MODEL_STATE_STR(snap.model_state),
+                          val_to_str(snap.model_t, UNITS_SECONDS, s, false));
 
         // stop time
         sdl_render_printf(pane, 0, ROW2Y(1,FPSZ_MEDIUM), FPSZ_MEDIUM, BLACK, WHITE, 
                           "%-8s %s", 
                           "STOP_T",
-                          val_to_str(stop_t, UNITS_SECONDS, s, false));
+                          val_to_str(snap.stop_t, UNITS_SECONDS, s, false));
+
+        // steps per second, computed over intervals of at least 0.5 secs,
+        // only display while running
+        now_us = microsec_timer();
+        if (snap.model_state != MODEL_STATE_RUNNING || snap.total_steps < vars->rate_total_steps) {
+            vars->rate_us = now_us;
+            vars->rate_total_steps = snap.total_steps;
+            vars->steps_per_sec = 0;
+        } else if (now_us - vars->rate_us >= 500000) {
+            vars->steps_per_sec = (snap.total_steps - vars->rate_total_steps) * 1e6 / 
+                                  (now_us - vars->rate_us);
+            vars->rate_us = now_us;
+            vars->rate_total_steps = snap.total_steps;
+        }
+        if (snap.model_state == MODEL_STATE_RUNNING && vars->steps_per_sec > 0) {
+            if (vars->steps_per_sec >= 1e6) {
+                sprintf(s, "%.1fM/s", vars->steps_per_sec / 1e6);
+            } else if (vars->steps_per_sec >= 1e3) {
+                sprintf(s, "%.0fK/s", vars->steps_per_sec / 1e3);
+            } else {
+                sprintf(s, "%.0f/s", vars->steps_per_sec);
+            }
+            sdl_render_printf(pane, pane->w-COL2X(9,FPSZ_MEDIUM)-2, ROW2Y(1,FPSZ_MEDIUM), FPSZ_MEDIUM, BLACK, WHITE, 
+                              "%9s", s);
+        }
 
         // delta_t time
         sdl_render_printf(pane, 0, ROW2Y(2,FPSZ_MEDIUM), FPSZ_MEDIUM, BLACK, WHITE, 
                           "%-8s %s", 
                           "DELTA_T", 
-                          val_to_str(delta_t, UNITS_SECONDS, s, false));
+                          val_to_str(snap.delta_t, UNITS_SECONDS, s, false));
 
         // failed_to_stabilize_count, only display if greater than 0
-        if (failed_to_stabilize_count > 0) {
+        if (snap.failed_to_stabilize_count > 0) {
             // XXX debug why the '-2' is needed below
             sdl_render_printf(pane, pane->w-COL2X(9,FPSZ_MEDIUM)-2, ROW2Y(3,FPSZ_MEDIUM), FPSZ_MEDIUM, RED, WHITE, 
-                              "%9d", failed_to_stabilize_count);
+                              "%9d", snap.failed_to_stabilize_count);
         }
 
         // register for mouse click events to control the model from the display
         sdl_render_text_and_register_event(
             pane, COL2X(0,FPSZ_MEDIUM), ROW2Y(3,FPSZ_MEDIUM), FPSZ_MEDIUM, "RESET", LIGHT_BLUE, WHITE,
             SDL_EVENT_MODEL_RESET, SDL_EVENT_TYPE_MOUSE_CLICK, pane_cx);
-        switch (model_state) {
+        switch (snap.model_state) {
         case MODEL_STATE_RESET:
             sdl_render_text_and_register_event(
                 pane, COL2X(9,FPSZ_MEDIUM), ROW2Y(3,FPSZ_MEDIUM), FPSZ_MEDIUM, "RUN", LIGHT_BLUE, WHITE,
@@ -821,6 +1275,8 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
 
     struct {
         int32_t y_scroll;
+        long double x_pan_t;
+        scope_trace_t trace[MAX_SCOPE];
     } * vars = pane_cx->vars;
     rect_t * pane = &pane_cx->pane;
 
@@ -831,6 +1287,7 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
     if (request == PANE_HANDLER_REQ_INITIALIZE) {
         vars = pane_cx->vars = calloc(1,sizeof(*vars));
         vars->y_scroll = 0;
+        vars->x_pan_t = 0;
         return PANE_HANDLER_RET_NO_ACTION;
     }
 
@@ -839,28 +1296,28 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
     // ------------------------
 
     if (request == PANE_HANDLER_REQ_RENDER) {
-        int32_t       i, j, count, x_left, y_top, units, x_title_str, color;
+        #define YHEADER          60
+        #define GRAPH_YSPAN      160
+        #define GRAPH_YSPACE     40
+        #define MAX_GRAPH_XSPAN  4000
+
+        int32_t       i, x_left, y_top, units, x_title_str, color;
         int32_t       y_scroll_min, y_scroll_max, last_defined_scope;
-        int32_t       y_axis_bottom;
-        char          p[100], s1[100], s2[100], *select_str, *ymin_str, *ymax_str, *gl0_str, *gl1_str;
-        char          *title_str, ymax_str2[100], ymin_str2[100], title_str_ext[100];
-        long double   ymin, ymax;
-        hist_t       *history0, *history1;
+        int32_t       y_axis_bottom, graph_xspan;
+        char          s1[100], s2[100], s3[100];
+        char          *title_str, ymax_str2[100], ymin_str2[100], title_str_ext[200];
+        long double   ymin, ymax, span_t, start_t;
         gridloc_t     gl0, gl1;
-        point_t       points[2*MAX_HISTORY];
-        float         sign;
-
-        #define YHEADER       60
-        #define GRAPH_YSPAN   160
-        #define GRAPH_YSPACE  40
-        #define GRAPH_XSPAN   500
-
-        // the graph xspan must equal MAX_HISTORY, because there
-        // is currently no x-scaling done for the graphs
-        if (GRAPH_XSPAN != MAX_HISTORY) {
-            FATAL("GRAPH_XSPAN %d must equal MAX_HISTORY %d\n",
-                  GRAPH_XSPAN, MAX_HISTORY);
-        }
+        probe_t      probe_copy, *p;
+
+        // the graph xspan is determined by the pane width; 
+        // and the time range displayed is scope_span_t starting at history_t,
+        // adjusted by the pan offset
+        graph_xspan = pane->w - 24;
+        if (graph_xspan > MAX_GRAPH_XSPAN) graph_xspan = MAX_GRAPH_XSPAN;
+        if (graph_xspan < 1) graph_xspan = 1;
+        span_t  = frame.scope_span_t;
+        start_t = history_t + vars->x_pan_t;
 
         // clear scope_select_enabled; it will be set below if there is a selected scope
         scope_select.enabled = false;
@@ -869,7 +1326,7 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
         // last scope defined
         last_defined_scope = -1;
         for (i = 0; i < MAX_SCOPE; i++) {
-            if (strncasecmp(param_str_val(PARAM_SCOPE_A+i), "off", 3) != 0) {
+            if (frame.scope_defined[i]) {
                 last_defined_scope = i;
             }
         }
@@ -889,77 +1346,23 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
         // loop over the scopes, displaying each
         for (i = 0; i < MAX_SCOPE; i++) {
             // if the model is reset then continue
-            if (model_state == MODEL_STATE_RESET) {
+            if (snap.model_state == MODEL_STATE_RESET) {
                 goto no_scope;
             }
 
-            // init
-            history0 = NULL;
-            history1 = NULL;
-            sign = 1;
-
-            // parse and verify this scope's params; if invalid then continue, examples:
-            // - off
-            // - voltage,0v,5v,c3,c4,this-is-the-title
-            // - current,-100ma,100ma,c3,c4,this-is-the-title
-            strcpy(p, param_str_val(PARAM_SCOPE_A+i));
-            select_str = strtok(p, ",");
-            ymin_str = strtok(NULL, ",");
-            ymax_str = strtok(NULL, ",");
-            gl0_str = strtok(NULL, ",");
-            gl1_str = strtok(NULL, ",");
-            title_str = strtok(NULL, "");
-            if (title_str == NULL) {
+            // get this scope's probe, which the model_thread resolved from the 
+            // scope param; if the scope param is off or invalid then continue
+            probe_get(i, &probe_copy);
+            p = &probe_copy;
+            if (p->type == PROBE_NONE || p->history == NULL) {
                 goto no_scope;
             }
-            if (strcasecmp(select_str,"voltage") != 0 && 
-                strcasecmp(select_str,"current") != 0) 
-            {
-                goto no_scope;
-            }
-            units = (strcasecmp(select_str,"voltage") == 0) ? UNITS_VOLTS : UNITS_AMPS;
-            if ((str_to_val(ymin_str, units, &ymin) < 0) ||
-                (str_to_val(ymax_str, units, &ymax) < 0) ||
-                (str_to_gridloc(gl0_str, &gl0) < 0) ||
-                (grid[gl0.x][gl0.y].node == NULL) ||
-                (str_to_gridloc(gl1_str, &gl1) < 0) ||
-                (grid[gl1.x][gl1.y].node == NULL))
-            {
-                goto no_scope;
-            }
-            if (strcasecmp(select_str,"voltage") == 0) {
-                history0 = grid[gl0.x][gl0.y].node->v_history;
-                history1 = grid[gl1.x][gl1.y].node->v_history;
-                sign = 1;
-            } else {  // must be current
-                // search for the component between gl0 and gl1
-                grid_t *g;
-                component_t *c;
-                g = &grid[gl0.x][gl0.y];
-                for (j = 0; j < g->max_term; j++) {
-                    c = g->term[j]->component;
-                    if (c->type == COMP_NONE || c->type == COMP_WIRE) {
-                        continue;
-                    }
-                    if (memcmp(&c->term[0].gridloc, &gl0, sizeof(gridloc_t)) == 0 && 
-                        memcmp(&c->term[1].gridloc, &gl1, sizeof(gridloc_t)) == 0) 
-                    {
-                        history0 = c->i_history;
-                        sign = 1;
-                        break;
-                    } else if (memcmp(&c->term[0].gridloc, &gl1, sizeof(gridloc_t)) == 0 && 
-                               memcmp(&c->term[1].gridloc, &gl0, sizeof(gridloc_t)) == 0) 
-                    {
-                        history0 = c->i_history;
-                        sign = -1;
-                        break;
-                    }
-                }
-                if (j == g->max_term) {
-                    // component not found between gl0 and gl1
-                    goto no_scope;
-                }
-            }
+            units     = p->units;
+            ymin      = p->ymin;
+            ymax      = p->ymax;
+            gl0       = p->gl0;
+            gl1       = p->gl1;
+            title_str = p->title;
 
             // if this is the selected scope then 
             //   display it in BLUE
@@ -969,7 +1372,7 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
             //   display the scope in BLACK
             // endif
             // note that scope_select_idx==0 means not defined, 1==scope_a, etc
-            if (i == scope_select_idx-1) {
+            if (i == frame.scope_select_idx-1) {
                 color = BLUE;
                 scope_select.gl0 = gl0;
                 scope_select.gl1 = gl1;
@@ -996,6 +1399,12 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
                 continue;
             }
 
+            // render the scope trace texture, which is updated with just the 
+            // columns of the graph whose values have been recorded since the 
+            // prior render; and display it
+            scope_trace_render(&vars->trace[i], p, graph_xspan, GRAPH_YSPAN, start_t, span_t, color);
+            sdl_render_texture(pane, x_left, y_top, vars->trace[i].texture);
+
             // display y axis
             // note - the reason for limitting y_axis_bottom to pane boundary is due to 
             //        a limitiation in util_sdl.c, where lines that are attempted to be 
@@ -1005,78 +1414,12 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
             sdl_render_line(pane, x_left, y_top, x_left, y_axis_bottom, color);
             sdl_render_line(pane, x_left-1, y_top, x_left-1, y_axis_bottom, color);
 
-            // display x axis, at the 0 volt y intercept; 
-            // if there is no 0 volt y intercept then don't display 
-            // the x axis
-            if (ymin <= 0 && ymax >= 0) {
-                int32_t y = y_top + ymax / (ymax - ymin) * GRAPH_YSPAN;
-                sdl_render_line(pane, x_left, y, x_left + GRAPH_XSPAN - 1, y, color);
-                sdl_render_line(pane, x_left, y+1, x_left + GRAPH_XSPAN - 1, y+1, color);
-            }
-
-            // create array of points 
-            count = 0;
-            for (j = 0; j < max_history; j++) {
-                float va=0, vb=0;
-                int32_t ya,yb;
-
-                // if history1 is NULL then
-                //   we are displaying current data, set va and vb to the range of current values
-                // else
-                //   we are displaying voltage data between two nodes; set va and vb to 
-                //    represent the range of difference between the two nodes; as seen below
-                //    there are 2 approaches, I had hoped to use the first approach but the
-                //    2nd produces better graphs in some cases
-                // endif
-                if (history1 == NULL) {
-                    va = sign * history0[j].max;
-                    vb = sign * history0[j].min;
-                } else {
-#if 0
-                    va = sign * (history0[j].max - history1[j].min);
-                    vb = sign * (history0[j].min - history1[j].max);
-#else
-                    va = sign * (history0[j].max - history1[j].max);
-                    vb = sign * (history0[j].min - history1[j].min);
-#endif
-                }
-
-                // if either va or vb is not-a-number that means there is no value to be
-                // displayed for this scope 'x' coordinate; so continue
-                if (isnan(va) || isnan(vb)) {
-                    continue;
-                }
-
-                // limit the value range (va..vb) to be displayed at this x coord to
-                // the scope value range, ymin..ymax
-                if (va > ymax) va = ymax; else if (va < ymin) va = ymin;
-                if (vb > ymax) vb = ymax; else if (vb < ymin) vb = ymin;
-
-                // convert the value range (va..vb) to y coord range (ya..yb)
-                ya = y_top + (ymax - va) / (ymax - ymin) * GRAPH_YSPAN;
-                yb = y_top + (ymax - vb) / (ymax - ymin) * GRAPH_YSPAN;
-
-                // add the j,ya and j,yb points to the array of points that
-                // will be rendered as a line by code following this loop
-                points[count].x = x_left + j;
-                points[count].y = ya;
-                count++;
-                if (ya != yb) {
-                    points[count].x = x_left + j;
-                    points[count].y = yb;
-                    count++;
-                }
-            }
-
-            // display the graph
-            sdl_render_lines(pane, points, count, color);
-
             // display the graph title
-            sprintf(title_str_ext, "%c: %s - %s", 
+            snprintf(title_str_ext, sizeof(title_str_ext), "%c: %s - %.*s", 
                     'A' + i,
                     units == UNITS_VOLTS ? "VOLTAGE" : "CURRENT", 
-                    title_str);
-            x_title_str = x_left + GRAPH_XSPAN/2 - COL2X(strlen(title_str_ext),FPSZ_SMALL)/2;
+                    (int)sizeof(p->title), title_str);
+            x_title_str = x_left + graph_xspan/2 - COL2X(strlen(title_str_ext),FPSZ_SMALL)/2;
             if (x_title_str < x_left) x_title_str = x_left;
             sdl_render_printf(pane, x_title_str, y_top-FPSZ_SMALL-1, FPSZ_SMALL, color, WHITE, "%s", title_str_ext);
 
@@ -1089,7 +1432,7 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
             // register the scope select events; if a scope is clicked then it is 
             // selected and will be displayed in BLUE, and the associated gridlocs and
             // component will also be displayed in BLUE
-            rect_t loc = { x_left, y_top, GRAPH_XSPAN, GRAPH_YSPAN };
+            rect_t loc = { x_left, y_top, graph_xspan, GRAPH_YSPAN };
             sdl_register_event(pane, 
                                &loc, 
                                SDL_EVENT_SCOPE_SELECT_A + i,
@@ -1100,7 +1443,7 @@ static int32_t pane_hndlr_scope(pane_cx_t * pane_cx, int32_t request, void * ini
             continue;
 
 no_scope:   // scope is now off or improperly defined
-            if (i == scope_select_idx-1) {
+            if (i == frame.scope_select_idx-1) {
                 scope_select_idx = 0;
             }
         }
@@ -1109,16 +1452,18 @@ no_scope:   // scope is now off or improperly defined
         rect_t loc = {0, 0, pane->w, sdl_font_char_height(FPSZ_MEDIUM)};
         sdl_render_fill_rect(pane, &loc, WHITE);
         sdl_render_printf(pane, 0, 0, FPSZ_MEDIUM, BLACK, WHITE, 
-                          "%s  SPAN=%s",
-                          val_to_str(history_t, UNITS_SECONDS, s1, true),
-                          val_to_str(param_num_val(PARAM_SCOPE_SPAN_T), UNITS_SECONDS, s2, true));
+                          "%s  SPAN=%s%s%s",
+                          val_to_str(start_t, UNITS_SECONDS, s1, true),
+                          val_to_str(span_t, UNITS_SECONDS, s2, true),
+                          vars->x_pan_t ? "  PAN=" : "",
+                          vars->x_pan_t ? val_to_str(vars->x_pan_t, UNITS_SECONDS, s3, true) : "");
 
         // scope trigger control
         // - display MODE button
         sdl_render_text_and_register_event(
             pane, pane->w-COL2X(9,FPSZ_MEDIUM), 0, FPSZ_MEDIUM, "MODE", LIGHT_BLUE, WHITE,
             SDL_EVENT_SCOPE_MODE, SDL_EVENT_TYPE_MOUSE_CLICK, pane_cx);
-        if (strcasecmp(param_str_val(PARAM_SCOPE_MODE), "continuous") == 0) {
+        if (frame.scope_continuous) {
             sdl_render_printf(
                pane, pane->w-COL2X(4,FPSZ_MEDIUM), 0, 
                FPSZ_MEDIUM, BLACK, WHITE, "CONT");
@@ -1154,6 +1499,24 @@ no_scope:   // scope is now off or improperly defined
         case SDL_EVENT_MOUSE_MOTION2:
             vars->y_scroll -= event->mouse_motion.delta_y;
             break;
+        case SDL_EVENT_KEY_LEFT_ARROW:
+        case SDL_EVENT_KEY_RIGHT_ARROW: {
+            // pan by a tenth of the scope span
+            long double span_t = param_num_val(PARAM_SCOPE_SPAN_T);
+            vars->x_pan_t += (event->event_id == SDL_EVENT_KEY_LEFT_ARROW ? -span_t : span_t) / 10;
+            break; }
+        case SDL_EVENT_KEY_HOME:
+            vars->x_pan_t = 0;
+            break;
+        case '+': case '=': case '-': {
+            // zoom by changing the scope span; the probe history is
+            // retained, so this does not require the model to be rerun
+            char span_str[100];
+            long double span_t = param_num_val(PARAM_SCOPE_SPAN_T);
+            span_t = (event->event_id == '-' ? span_t * 2 : span_t / 2);
+            sprintf(span_str, "%.6Lgs", span_t);
+            param_set(PARAM_SCOPE_SPAN_T, span_str);
+            break; }
         }
         return PANE_HANDLER_RET_NO_ACTION;
     }
@@ -1163,6 +1526,10 @@ no_scope:   // scope is now off or improperly defined
     // ---------------------------
 
     if (request == PANE_HANDLER_REQ_TERMINATE) {
+        int32_t i;
+        for (i = 0; i < MAX_SCOPE; i++) {
+            scope_trace_free(&vars->trace[i]);
+        }
         free(vars);
         return PANE_HANDLER_RET_NO_ACTION;
     }
@@ -1172,3 +1539,144 @@ no_scope:   // scope is now off or improperly defined
     return PANE_HANDLER_RET_NO_ACTION;
 }
 
+// render the probe's history to the scope trace texture; the texture is fully 
+// redrawn when the time range, value range, color, or size changes, or when the 
+// probe's history has been cleared; otherwise only the columns starting with the 
+// first column that did not contain final values are redrawn
+static void scope_trace_render(scope_trace_t * tr, probe_t * p, int32_t width, int32_t height,
+                               long double start_t, long double span_t, int32_t color)
+{
+    int32_t     c, c_first, c_end, cols_final, cols_recorded, y, y_axis, ya, yb, lo, hi;
+    uint32_t    pixel_color, pixel_white, *pix;
+    uint64_t    history_gen;
+    long double interval, newest_start_t, newest_end_t, ymin, ymax;
+    hist_t      history[width];
+    float       va, vb;
+    rect_t      loc;
+
+    // allocate the texture and pixels when first called, or if the size changed
+    if (tr->texture == NULL || tr->width != width || tr->height != height) {
+        scope_trace_free(tr);
+        tr->texture = sdl_create_texture(width, height);
+        if (tr->texture == NULL) {
+            return;
+        }
+        tr->pixels = malloc(width * height * sizeof(uint32_t));
+        tr->y_last = malloc(width * sizeof(int32_t));
+        assert(tr->pixels && tr->y_last);
+        tr->width = width;
+        tr->height = height;
+        tr->cols_done = -1;
+    }
+
+    // determine which columns to redraw; the columns prior to cols_final 
+    // contain final values, and the columns prior to cols_recorded contain 
+    // the values recorded so far
+    ymin = p->ymin;
+    ymax = p->ymax;
+    history_gen = __atomic_load_n(&p->history_gen, __ATOMIC_ACQUIRE);
+    interval = span_t / width;
+    if (probe_get_newest(p, &newest_start_t, &newest_end_t) < 0) {
+        cols_final = cols_recorded = 0;
+    } else {
+        cols_final = (newest_start_t < start_t ? 0 : (newest_start_t - start_t) / interval);
+        cols_recorded = (newest_end_t < start_t ? 0 : ceill((newest_end_t - start_t) / interval));
+        if (cols_final > width) cols_final = width;
+        if (cols_recorded > width) cols_recorded = width;
+    }
+
+    if (tr->cols_done < 0 ||
+        tr->start_t != start_t ||
+        tr->span_t != span_t ||
+        tr->ymin != ymin ||
+        tr->ymax != ymax ||
+        tr->color != color ||
+        tr->history_gen != history_gen)
+    {
+        tr->start_t = start_t;
+        tr->span_t = span_t;
+        tr->ymin = ymin;
+        tr->ymax = ymax;
+        tr->color = color;
+        tr->history_gen = history_gen;
+        c_first = 0;
+        c_end = width;
+    } else {
+        c_first = tr->cols_done;
+        c_end = cols_recorded;
+    }
+    tr->cols_done = cols_final;
+    if (c_end <= c_first) {
+        return;
+    }
+
+    // get the min/max of the probe's history for the columns being redrawn
+    probe_get_history(p, start_t + c_first * interval, (c_end - c_first) * interval, 
+                      c_end - c_first, history);
+
+    // determine the y coord of the x axis, at the 0 y intercept; 
+    // if there is no 0 y intercept then the x axis is not drawn
+    y_axis = (ymin <= 0 && ymax >= 0 ? ymax / (ymax - ymin) * height : -1);
+
+    // redraw the columns
+    pixel_color = sdl_color_to_pixel(color);
+    pixel_white = sdl_color_to_pixel(WHITE);
+    for (c = c_first; c < c_end; c++) {
+        pix = tr->pixels + c;
+
+        // background and x axis
+        for (y = 0; y < height; y++) {
+            pix[y*width] = pixel_white;
+        }
+        if (y_axis >= 0 && y_axis < height) pix[y_axis*width] = pixel_color;
+        if (y_axis+1 >= 0 && y_axis+1 < height) pix[(y_axis+1)*width] = pixel_color;
+
+        // if there is no value to be displayed at this column then continue
+        va = history[c-c_first].max;
+        vb = history[c-c_first].min;
+        if (isnan(va) || isnan(vb)) {
+            tr->y_last[c] = -1;
+            continue;
+        }
+
+        // limit the value range (va..vb) to the scope value range, ymin..ymax, 
+        // and convert to the y coord range (ya..yb)
+        if (va > ymax) va = ymax; else if (va < ymin) va = ymin;
+        if (vb > ymax) vb = ymax; else if (vb < ymin) vb = ymin;
+        ya = (ymax - va) / (ymax - ymin) * height;
+        yb = (ymax - vb) / (ymax - ymin) * height;
+        if (ya > height-1) ya = height-1;
+        if (yb > height-1) yb = height-1;
+
+        // draw the trace at this column, extended to connect with the 
+        // trace in the prior column
+        lo = ya;
+        hi = yb;
+        if (c > 0 && tr->y_last[c-1] >= 0) {
+            if (tr->y_last[c-1] < lo) lo = tr->y_last[c-1];
+            if (tr->y_last[c-1] > hi) hi = tr->y_last[c-1];
+        }
+        for (y = lo; y <= hi; y++) {
+            pix[y*width] = pixel_color;
+        }
+        tr->y_last[c] = yb;
+    }
+
+    // update the texture with the redrawn columns
+    loc.x = c_first;
+    loc.y = 0;
+    loc.w = c_end - c_first;
+    loc.h = height;
+    sdl_update_texture_rect(tr->texture, &loc, (uint8_t*)(tr->pixels + c_first), width);
+}
+
+static void scope_trace_free(scope_trace_t * tr)
+{
+    if (tr->texture) {
+        sdl_destroy_texture(tr->texture);
+    }
+    free(tr->pixels);
+    free(tr->y_last);
+    memset(tr, 0, sizeof(scope_trace_t));
+}
+
@@ -28,6 +28,14 @@ SOFTWARE.
 
 #define MAX_PARAM 50
 
+// hash of gridloc gl, for a hash table with n buckets; x,y are combined into
+// one number, which is scrambled by multiplying with a large odd constant
+#define GRID_HASH(gl,n) \
+    ((uint32_t)((((uint64_t)(gl)->x * MAX_GRID_Y + (gl)->y) * 0x9e3779b97f4a7c15ULL) >> 32) % (n))
+
+// the grid locations are allocated in blocks of this many, see grid_alloc
+#define GRID_BLOCK 1024
+
 //
 // typedefs
 //
@@ -46,6 +54,21 @@ typedef struct {
 
 static param_t param[MAX_PARAM];
 
+static solver_config_t solver_config;
+static uint64_t        solver_config_seq;
+static pthread_mutex_t solver_config_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool            batch_mode;
+static char          * output_filename;
+
+static int32_t       * free_component;       // stack of free component tbl entries
+static int32_t         max_free_component;
+static int32_t         max_alloced_free_component;
+
+static bool            grid_connectivity_stale;  // grid_connectivity_update is needed
+static grid_t       ** grid_hash;            // hash table of the grid, see grid_get
+static int32_t         max_grid_hash;
+
 //
 // prototypes
 //
@@ -55,6 +78,7 @@ static void help(void);
 
 static void * cli_thread(void * cx);
 static int32_t process_cmd(char * cmdline);
+static int32_t process_cmd_locked(char * cmdline);
 static int32_t cmd_set(char *args);
 static int32_t cmd_show(char *args);
 static int32_t cmd_clear_all(char *args);
@@ -62,22 +86,32 @@ static int32_t cmd_read(char *args);
 static int32_t cmd_write(char *args);
 static int32_t cmd_add(char *args);
 static int32_t cmd_del(char *args);
+static int32_t cmd_setval(char *args);
 static int32_t cmd_ground(char *args);
 static int32_t cmd_reset(char *args);
 static int32_t cmd_run(char *args);
 static int32_t cmd_stop(char *args);
 static int32_t cmd_cont(char *args);
 static int32_t cmd_step(char *args);
+static int32_t cmd_bench(char *args);
 static int32_t cmd_help(char *args);
 static int32_t cmd_printscreen(char *args);
+static int32_t cmd_record(char *args);
 
 static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char *value_str);
 static int32_t del_component(char * comp_str);
+static int32_t set_component_value(char * comp_str, char * value_str);
+static int32_t parse_component_value(component_t * c, char * value_str);
 
 static void param_init(void);
+static void publish_solver_config(void);
 
-static void identify_grid_ground(gridloc_t *gl);
+static grid_t * grid_root(grid_t * g);
+static void grid_union(gridloc_t gl0, gridloc_t gl1);
+static void grid_connectivity_update(void);
 static void grid_init(void);
+static grid_t * grid_alloc(gridloc_t * gl);
+static void component_alloc(void);
 
 // -----------------  MAIN  -----------------------------------------------
 
@@ -93,7 +127,7 @@ int32_t main(int32_t argc, char ** argv)
 
     // get and process options
     while (true) {
-        char opt_char = getopt(argc, argv, "h");
+        char opt_char = getopt(argc, argv, "hbo:");
         if (opt_char == -1) {
             break;
         }
@@ -101,6 +135,12 @@ int32_t main(int32_t argc, char ** argv)
         case 'h':
             help();
             return 0;
+        case 'b':
+            batch_mode = true;
+            break;
+        case 'o':
+            output_filename = optarg;
+            break;
         default:
             return 1;
             break;
@@ -111,8 +151,8 @@ int32_t main(int32_t argc, char ** argv)
     filename = (argc - optind >= 1) ? argv[optind] : NULL;
     pthread_create(&thread_id, NULL, cli_thread, filename);
 
-    // call display handler
-    display_handler();
+    // call display handler; in batch mode the display is rendered offscreen
+    display_handler(batch_mode);
 
     // restore terminal attibutes
     rl_deprep_terminal();
@@ -129,8 +169,12 @@ static void main_init(void)
 
 static void help(void)
 {
-    printf("usage: model [-h] [<filename>]\n");
+    printf("usage: model [-h] [-b] [-o <filename.png|.jpg>] [<filename>]\n");
     printf("  -h: help\n");
+    printf("  -b: batch mode, the display is rendered offscreen, and when the\n");
+    printf("      commands have been processed the program waits for the run to\n");
+    printf("      complete and exits\n");
+    printf("  -o: print the display to this file when the commands have been processed\n");
     printf("\n");
 
     printf("commands:\n");
@@ -150,7 +194,10 @@ static void * cli_thread(void * cx)
 
     // if filename arg was supplied on cmdline then read commands from the file
     if (filename) {
+        display_lock();
         cmd_read(filename);
+        grid_connectivity_update();
+        display_unlock();
     }
 
     // use readline/add_history to read commands, and
@@ -176,6 +223,21 @@ static void * cli_thread(void * cx)
         process_cmd(cmd_str);
     }
 
+    // in batch mode wait for the run to complete, so that the display printed 
+    // below shows the completed run
+    if (batch_mode) {
+        model_wait_not_running(0);
+    }
+
+    // if an output file was supplied on the cmdline then print the display to it, 
+    // and wait for the display to be redrawn and printed before exitting
+    if (output_filename) {
+        display_lock();
+        display_print_screen(output_filename);
+        display_unlock();
+        display_sync();
+    }
+
     // exit must come from the util_sdl display_handler; 
     // so inject the SDL_EVENT_QUIT
     memset(&event,0,sizeof(event));
@@ -190,13 +252,15 @@ static struct {
     char * usage;
 } cmd_tbl[] = {
     { "set",             cmd_set,             "<param_name> <param_value>"       },
-    { "show",            cmd_show,            "[<components|params|ground>]"     },
+    { "show",            cmd_show,            "[<components|params|ground>] | "
+                                              "history <t_start> <t_span> <samples> | perf" },
 
     { "clear_all",       cmd_clear_all,       "",                                },
     { "read",            cmd_read,            "<filename>"                       },
     { "write",           cmd_write,           "[<filename>]"                     },
     { "add",             cmd_add,             "<type> <gl0> <gl1> [<values>]"    },
     { "del",             cmd_del,             "<comp_str>"                       },
+    { "setval",          cmd_setval,          "<comp_str> <value>"               },
     { "ground",          cmd_ground,          "<gl>"                             },
 
     { "reset",           cmd_reset,           ""                                 },
@@ -204,14 +268,31 @@ static struct {
     { "stop",            cmd_stop,            ""                                 },
     { "cont",            cmd_cont,            "[<secs>]"                         },
     { "step",            cmd_step,            "[<count>]"                        },
+    { "bench",           cmd_bench,           "[<secs>] [<max_wall_secs>]"       },
 
     { "help",            cmd_help,            ""                                 },
-    { "printscreen",     cmd_printscreen,     ""                                 },
+    { "printscreen",     cmd_printscreen,     "[<filename.png|.jpg>]"            },
+    { "record",          cmd_record,          "<filename.png|.jpg>|off"          },
                     };
 
 #define MAX_CMD_TBL (sizeof(cmd_tbl) / sizeof(cmd_tbl[0]))
 
+// process a command, with the display lock held; the grid's union-find, 
+// which may have been invalidated by the command, is rebuilt before the 
+// display lock is released
 static int32_t process_cmd(char * cmdline)
+{
+    int32_t rc;
+
+    display_lock();
+    rc = process_cmd_locked(cmdline);
+    grid_connectivity_update();
+    display_unlock();
+    return rc;
+}
+
+// process a command, the caller must hold the display lock
+static int32_t process_cmd_locked(char * cmdline)
 {
     char *comment_char;
     char *cmd, *args;
@@ -254,9 +335,7 @@ static int32_t process_cmd(char * cmdline)
     // find cmd in cmd_tbl
     for (i = 0; i < MAX_CMD_TBL; i++) {
         if (strcasecmp(cmd, cmd_tbl[i].name) == 0) {
-            display_lock();
             rc = cmd_tbl[i].proc(args);
-            display_unlock();
             if (rc < 0) {
                 ERROR("failed: '%s'\n", cmdline_orig);
                 return -1;
@@ -300,7 +379,7 @@ static int32_t cmd_show(char *args)
     int32_t i;
     bool show_all, printed=false;
     char *what;
-    char s[100];
+    char s[300];
 
     // determine what is to be shown
     what = strtok(args, " ");
@@ -326,7 +405,7 @@ static int32_t cmd_show(char *args)
             if (c->type == COMP_NONE) {
                 continue;
             }
-            INFO("  %-8s %s\n", c->comp_str, component_to_full_str(c,s));
+            INFO("  %-8s %s\n", c->comp_str, component_to_full_str(c,s,sizeof(s)));
         }
         BLANK_LINE;
         printed = true;
@@ -340,6 +419,115 @@ static int32_t cmd_show(char *args)
         printed = true;
     }
 
+    // show the history recorded by the scopes' probes, for the time range 
+    // t_start to t_start+t_span divided into samples intervals; this is printed
+    // to stdout, so that it can be processed by scripts, one line per interval:
+    //   history <scope> <interval_start_t> <interval_end_t> <min> <max>
+    // intervals that have no recorded values are printed as nan
+    if (!show_all && strcasecmp(what,"history") == 0) {
+        char *t_start_str, *t_span_str, *samples_str;
+        long double t_start, t_span, interval;
+        int32_t samples, j;
+        hist_t *out;
+        probe_t p;
+
+        t_start_str = strtok(NULL, " ");
+        t_span_str = strtok(NULL, " ");
+        samples_str = strtok(NULL, " ");
+        if (t_start_str == NULL || t_span_str == NULL || samples_str == NULL) {
+            ERROR("insufficient args\n");
+            return -1;
+        }
+        if (str_to_val(t_start_str, UNITS_SECONDS, &t_start) < 0 ||
+            str_to_val(t_span_str, UNITS_SECONDS, &t_span) < 0 || t_span <= 0 ||
+            sscanf(samples_str, "%d", &samples) != 1 || samples <= 0 || samples > 100000) {
+            ERROR("invalid args\n");
+            return -1;
+        }
+
+        out = malloc(samples * sizeof(hist_t));
+        assert(out);
+        interval = t_span / samples;
+        for (i = 0; i < MAX_SCOPE; i++) {
+            probe_get(i, &p);
+            if (p.type == PROBE_NONE) {
+                continue;
+            }
+            probe_get_history(&p, t_start, t_span, samples, out);
+            for (j = 0; j < samples; j++) {
+                printf("history %c %.9Lg %.9Lg %.9g %.9g\n",
+                       'a' + i, 
+                       t_start + j * interval,
+                       t_start + (j + 1) * interval,
+                       out[j].min, out[j].max);
+            }
+        }
+        fflush(stdout);
+        free(out);
+        printed = true;
+    }
+
+    // show the cpu time spent in each of the solver's phases, per time step,
+    // and the histogram of the iterations needed by the time steps to stabilize;
+    // a sample of the steps is timed; 'other' is the remainder of the total,
+    // mostly the delta_t and breakpoint handling and the snapshot publishing
+    if (!show_all && strcasecmp(what,"perf") == 0) {
+        static model_snapshot_t snap;
+        double ns_per_tick, phase_ns, total_ns;
+
+        model_get_snapshot(&snap);
+        INFO("PERF\n");
+        if (snap.total_steps == 0 || snap.perf_sampled_steps == 0 || snap.perf_ticks_per_sec == 0) {
+            INFO("  no time steps\n");
+            BLANK_LINE;
+            return 0;
+        }
+        ns_per_tick = 1e9 / snap.perf_ticks_per_sec;
+        total_ns = snap.perf_total_ticks * ns_per_tick / snap.perf_sampled_steps;
+
+        INFO("  %-10s %12s %6s\n", "phase", "ns/step", "%");
+        phase_ns = 0;
+        for (i = 0; i < MAX_PERF_PHASE; i++) {
+            double ns = snap.perf_ticks[i] * ns_per_tick / snap.perf_sampled_steps;
+            INFO("  %-10s %12.1f %6.1f\n", PERF_PHASE_STR(i), ns, 100 * ns / total_ns);
+            phase_ns += ns;
+        }
+        if (phase_ns > total_ns) {
+            phase_ns = total_ns;
+        }
+        INFO("  %-10s %12.1f %6.1f\n", "other", total_ns - phase_ns, 100 * (total_ns - phase_ns) / total_ns);
+        INFO("  %-10s %12.1f\n", "total", total_ns);
+        BLANK_LINE;
+
+        INFO("  steps=%lu  avg_iterations=%.2f  max_iterations=%d\n",
+             snap.total_steps,
+             (double)snap.total_iterations / snap.total_steps,
+             snap.max_iterations);
+        if (snap.total_slow_steps != 0) {
+            // multirate is on, the iterations of the slow partition's steps
+            // are included in avg_iterations, but not in the histogram
+            INFO("  slow_nodes=%d  slow_steps=%lu\n",
+                 snap.max_slow_node, snap.total_slow_steps);
+        }
+        INFO("  %-13s %12s %6s\n", "iterations", "steps", "%");
+        for (i = 0; i < MAX_PERF_HIST; i++) {
+            if (snap.iteration_hist[i] == 0) {
+                continue;
+            }
+            if (i == 0) {
+                sprintf(s, "1");
+            } else if (i == MAX_PERF_HIST-1) {
+                sprintf(s, "%d+", 1 << i);
+            } else {
+                sprintf(s, "%d-%d", 1 << i, (1 << (i+1)) - 1);
+            }
+            INFO("  %-13s %12lu %6.1f\n",
+                 s, snap.iteration_hist[i], 100. * snap.iteration_hist[i] / snap.total_steps);
+        }
+        BLANK_LINE;
+        printed = true;
+    }
+
     // if nothing was shown then print error
     if (printed == false) {
         ERROR("not supported '%s'\n", what);
@@ -356,22 +544,24 @@ static int32_t cmd_clear_all(char *args)
     // reset model
     model_reset();
 
-    // free component power
+    // free power supply wave form tables
     for (i = 0; i < max_component; i++) {
-        timed_moving_average_free(component[i].watts);
+        waveform_free(&component[i]);
     }
 
     // remove all components
     max_component = 0;
-    memset(component,0,sizeof(component));
+    max_free_component = 0;
+    memset(component, 0, max_alloced_component * sizeof(component_t));
 
     // remove ground
     memset(&ground, 0, sizeof(ground));
     ground_is_set = false;
-    identify_grid_ground(NULL);
 
-    // re-initialize the grid
+    // re-initialize the grid, and its union-find
     grid_init();
+    grid_connectivity_stale = false;
+    netlist_version++;
 
     // init params
     param_init();
@@ -390,6 +580,7 @@ static int32_t cmd_read(char *args)
     FILE * fp;
     char s[200], *fn, filename[200];
     int32_t rc, fileline=0;
+    uint64_t start_us = microsec_timer();
 
     // get the filename to be read
     fn = strtok(args, " ");
@@ -409,10 +600,12 @@ static int32_t cmd_read(char *args)
         return -1;
     }
 
-    // read cmd lines from file, and call process_cmd 
+    // read cmd lines from file, and call process_cmd_locked; the display lock
+    // is held by the caller for the entire file, and the grid's union-find is 
+    // rebuilt at most once, when it is needed, rather than for each wire deleted
     while (fgets(s, sizeof(s), fp) != NULL) {
         fileline++;
-        rc = process_cmd(s);
+        rc = process_cmd_locked(s);
         if (rc < 0) {
             ERROR("aborting read of command from '%s', line %d\n", filename, fileline);
             fclose(fp);
@@ -422,6 +615,8 @@ static int32_t cmd_read(char *args)
 
     // close, and return success
     fclose(fp);
+    INFO("read %d lines from %s in %.3f secs\n", 
+         fileline, filename, (microsec_timer() - start_us) / 1000000.);
 
     // keep track of the current_filename, so if a subsequent read
     // or write cmd is issued without specied filename arg; then the
@@ -477,12 +672,12 @@ static int32_t cmd_write(char *args)
     fprintf(fp, "\n");
 
     for (i = 0; i < max_component; i++) {
-        char s[100];
+        char s[300];
         component_t *c = &component[i];
         if (c->type == COMP_NONE) {
             continue;
         }
-        fprintf(fp, "add %s\n", component_to_full_str(c,s));
+        fprintf(fp, "add %s\n", component_to_full_str(c,s,sizeof(s)));
     }
     fprintf(fp, "\n");
 
@@ -545,6 +740,22 @@ static int32_t cmd_del(char *args)
     return del_component(comp_str);
 }
 
+static int32_t cmd_setval(char *args)
+{
+    char *comp_str, *value;
+
+    // tokenize and verify args supplied
+    comp_str = strtok(args, " ");
+    value = strtok(NULL, " ");
+    if (comp_str == NULL || value == NULL) {
+        ERROR("insufficient args\n");
+        return -1;
+    }
+
+    // call set_component_value to do the work
+    return set_component_value(comp_str, value);
+}
+
 static int32_t cmd_ground(char *args)
 {
     int32_t rc;
@@ -566,12 +777,12 @@ static int32_t cmd_ground(char *args)
     }
 
     // reset model
-    // set the new_ground,
-    // identify grid ground locations
+    // set the new_ground, adding it to the grid if needed
     model_reset();
+    grid_alloc(&new_ground);
     ground = new_ground;
     ground_is_set = true;
-    identify_grid_ground(NULL);
+    netlist_version++;
     return 0;
 }
 
@@ -587,6 +798,7 @@ static int32_t cmd_run(char *args)
         ERROR("invalid time '%s'\n", secs_str);
         return -1;
     }
+    grid_connectivity_update();
     return model_run();
 }
 
@@ -602,6 +814,7 @@ static int32_t cmd_cont(char *args)
         ERROR("invalid time '%s'\n", secs_str);
         return -1;
     }
+    grid_connectivity_update();
     return model_cont();
 }
 
@@ -612,9 +825,100 @@ static int32_t cmd_step(char *args)
         ERROR("invalid step count '%s'\n", step_count_str);
         return -1;
     }
+    grid_connectivity_update();
     return model_step();
 }
 
+// copy s to json_str, escaping the chars that are not allowed in a JSON string
+static char * json_escape(char * json_str, int32_t size, char * s)
+{
+    char * p = json_str;
+
+    while (*s && p - json_str < size - 7) {
+        if (*s == '"' || *s == '\\') {
+            *p++ = '\\';
+            *p++ = *s;
+        } else if ((unsigned char)*s < 0x20) {
+            p += sprintf(p, "\\u%04x", (unsigned char)*s);
+        } else {
+            *p++ = *s;
+        }
+        s++;
+    }
+    *p = '\0';
+    return json_str;
+}
+
+// run the model from time 0 for the run_t param secs, waiting for the run to 
+// complete, and print the solver's performance as a line of JSON; the display
+// lock is released while waiting, so the display continues to be redrawn; if 
+// the run takes longer than max_wall_secs then it is stopped, and completed 
+// is false
+static int32_t cmd_bench(char *args)
+{
+    static model_snapshot_t snap;
+    char * secs_str = strtok(args, " ");
+    char * max_wall_secs_str = strtok(NULL, " ");
+    long double max_wall_secs = 0;
+    uint64_t start_us, wall_us;
+    double wall_secs;
+    struct rusage ru;
+    char circuit[sizeof(current_filename)*6];
+    int32_t rc;
+
+    // set the run_t param, and get max_wall_secs
+    if (secs_str && param_set(PARAM_RUN_T, secs_str) < 0) {
+        ERROR("invalid time '%s'\n", secs_str);
+        return -1;
+    }
+    if (max_wall_secs_str && 
+        (str_to_val(max_wall_secs_str, UNITS_SECONDS, &max_wall_secs) < 0 || max_wall_secs <= 0)) {
+        ERROR("invalid time '%s'\n", max_wall_secs_str);
+        return -1;
+    }
+
+    // run the model, and wait for it to complete
+    grid_connectivity_update();
+    start_us = microsec_timer();
+    if (model_run() < 0) {
+        return -1;
+    }
+    display_unlock();
+    rc = model_wait_not_running(max_wall_secs * 1000000);
+    display_lock();
+    if (rc < 0 && model_state == MODEL_STATE_RUNNING) {
+        model_stop();
+    }
+    wall_us = microsec_timer() - start_us;
+    wall_secs = wall_us / 1000000.;
+
+    // get the snapshot, which the model_thread publishes before it signals
+    // the change of model_state, and print the results
+    model_get_snapshot(&snap);
+    getrusage(RUSAGE_SELF, &ru);
+    printf("{\"circuit\": \"%s\", \"completed\": %s, \"model_t\": %.6Lg, \"delta_t\": %.6Lg, "
+           "\"nodes\": %d, \"components\": %d, \"wall_secs\": %.3f, \"steps\": %lu, "
+           "\"steps_per_sec\": %.4g, \"avg_iterations\": %.2f, \"max_iterations\": %d, "
+           "\"failed_to_stabilize_count\": %d, \"peak_rss_kb\": %ld}\n",
+           json_escape(circuit, sizeof(circuit), current_filename),
+           snap.model_t >= snap.stop_t ? "true" : "false",
+           snap.model_t,
+           snap.delta_t,
+           snap.max_node,
+           snap.max_component,
+           wall_secs,
+           snap.total_steps,
+           wall_secs > 0 ? snap.total_steps / wall_secs : 0,
+           snap.total_steps > 0 ? (double)snap.total_iterations / snap.total_steps : 0,
+           snap.max_iterations,
+           snap.failed_to_stabilize_count,
+           ru.ru_maxrss);
+    fflush(stdout);
+
+    // success
+    return 0;
+}
+
 static int32_t cmd_help(char *args)
 {
     int32_t i;
@@ -630,18 +934,29 @@ static int32_t cmd_printscreen(char *args)
 {
     char filename[200];
 
-    sprintf(filename, "%s.jpg", current_filename);
-    sdl_print_screen(filename, true, NULL);
+    // the default filename is the current_filename with .jpg extension
+    if (args[0] != '\0') {
+        display_print_screen(args);
+    } else {
+        sprintf(filename, "%s.jpg", current_filename);
+        display_print_screen(filename);
+    }
     return 0;
 }
 
+static int32_t cmd_record(char *args)
+{
+    return display_record(args);
+}
+
 // -----------------  ADD & DEL COMPOENTS  --------------------------------
 
 static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char *value_str)
 {
     component_t new_comp, *c;
-    int32_t idx, x0, y0, x1, y1, i, rc, color, type=-1;
+    int32_t idx, x0, y0, x1, y1, i, rc, type=-1;
     char *gl_str;
+    grid_t *g;
     bool ok;
 
     static char * component_type_str[] = {
@@ -678,17 +993,10 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
         return -1;
     }
 
-    // find the first available component tbl entry
-    for (idx = 0; idx < MAX_COMPONENT; idx++) {
-        if (component[idx].type == COMP_NONE) {
-            break;
-        }        
-    }
-    if (idx == MAX_COMPONENT) {
-        ERROR("too many components, max allowed = %d\n", MAX_COMPONENT);
-        return -1;
-    }
-    assert(idx <= max_component);
+    // use the most recently freed component tbl entry, if there is none then
+    // the new component is added at the end of the table, which is grown 
+    // as needed when the new component is committed below
+    idx = (max_free_component > 0 ? free_component[max_free_component-1] : max_component);
 
     // init new_comp ...
     // - zero new_comp struct
@@ -719,7 +1027,6 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
     }
     // - set term
     for (i = 0; i < 2; i++) {
-        new_comp.term[i].component = &component[idx];
         new_comp.term[i].termid = i;
         gl_str = (i == 0 ? gl0_str : gl1_str);
         rc = str_to_gridloc(gl_str, &new_comp.term[i].gridloc);
@@ -729,88 +1036,12 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
         }
     }
     // - set component value
-    switch (new_comp.type) {
-    case COMP_WIRE:
-        value_str = strtok(value_str, ",");
-        if (value_str) {
-            if (strcasecmp(value_str,"remote") != 0) {
-                ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-                return -1;
-            }
-            value_str = strtok(NULL, "");
-            color = sdl_color(value_str);
-            if (color == -1) {
-                ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-                return -1;
-            }
-            new_comp.wire.remote = true;
-            new_comp.wire.remote_color = color;
-        }
-        break;
-    case COMP_POWER:
-        value_str = strtok(value_str, ",");
-        rc = str_to_val(value_str, UNITS_VOLTS, &new_comp.power.volts);
-        if (rc == -1) {
-            ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-            return -1;
-        }
-        value_str = strtok(NULL, ",");
-        if (value_str != NULL) {
-            rc = str_to_val(value_str, UNITS_HZ, &new_comp.power.hz);
-            if (rc == -1) {
-                ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-                return -1;
-            }
-        }
-        value_str = strtok(NULL, "");
-        if (value_str != NULL) {
-            if (strcasecmp(value_str, "sine") == 0) {
-                new_comp.power.wave_form = WAVE_FORM_SINE;
-            } else if (strcasecmp(value_str, "square") == 0) {
-                new_comp.power.wave_form = WAVE_FORM_SQUARE;
-            } else if (strcasecmp(value_str, "triangle") == 0) {
-                new_comp.power.wave_form = WAVE_FORM_TRIANGLE;
-            } else {
-                ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-                return -1;
-            }
-        }            
-        break;
-    case COMP_RESISTOR:
-        rc = str_to_val(value_str, UNITS_OHMS, &new_comp.resistor.ohms);
-        if (rc == -1) {
-            ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-            return -1;
-        }
-        break;
-    case COMP_CAPACITOR:
-        rc = str_to_val(value_str, UNITS_FARADS, &new_comp.capacitor.farads);
-        if (rc == -1) {
-            ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-            return -1;
-        }
-        break;
-    case COMP_INDUCTOR:
-        value_str = strtok(value_str, ",");
-        rc = str_to_val(value_str, UNITS_HENRYS, &new_comp.inductor.henrys); 
-        if (rc == -1) {
-            ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-            return -1;
-        }
-        value_str = strtok(NULL, "");
-        if (value_str != NULL) {
-            rc = str_to_val(value_str, UNITS_AMPS, &new_comp.inductor.i_init);
-            if (rc == -1) {
-                ERROR("invalid value '%s' for %s\n", value_str, new_comp.type_str);
-                return -1;
-            }
-        }
-        break;
-    case COMP_DIODE:
-        break;
+    rc = parse_component_value(&new_comp, value_str);
+    if (rc < 0) {
+        return -1;
     }
-    // - set watts, average over 0.1s interval, using 1000 bins
-    new_comp.watts = timed_moving_average_alloc(0.1, 1000);
+    // - set watts, average over 0.1s interval
+    windowed_average_init(&new_comp.watts, 0.1);
 
     // verify terminals are adjacent, except for:
     // - COMP_WIRE - where they just need to be in the same row or column
@@ -830,7 +1061,7 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
     }
     if (!ok) {
         ERROR("invalid terminal locations '%s' '%s'\n", gl0_str, gl1_str);
-        timed_moving_average_free(new_comp.watts);
+        waveform_free(&new_comp);
         return -1;
     }
 
@@ -838,36 +1069,30 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
     // 2 grid locations don't already have a remote wire
     if (new_comp.type == COMP_WIRE && new_comp.wire.remote) {
         for (i = 0; i < 2; i++) {
-            grid_t * g = &grid[new_comp.term[i].gridloc.x][new_comp.term[i].gridloc.y];
-            if (g->has_remote_wire) {
-                ERROR("gridloc %s already has a remote wire\n", g->glstr);
-                timed_moving_average_free(new_comp.watts);
+            gridloc_t * gl = &new_comp.term[i].gridloc;
+            g = grid_get(gl);
+            if (g && g->has_remote_wire) {
+                char s1[50];
+                ERROR("gridloc %s already has a remote wire\n", gridloc_to_str(gl,s1));
                 return -1;
             }
         }
     }
         
-    // verify not overlapping with existing component
-    for (i = 0; i < max_component; i++) {
-        char s1[50], s2[50];
-        c = &component[idx];
-        if ((memcmp(&c->term[0].gridloc, &new_comp.term[0].gridloc, sizeof(gridloc_t)) == 0) &&
-            (memcmp(&c->term[1].gridloc, &new_comp.term[1].gridloc, sizeof(gridloc_t)) == 0)) 
-        {
-            ERROR("new_comp overlaps existing component at %s %s\n",
-                  gridloc_to_str(&c->term[0].gridloc,s1),
-                  gridloc_to_str(&c->term[1].gridloc,s2));
-            timed_moving_average_free(new_comp.watts);
-            return -1;
-        }
-        if ((memcmp(&c->term[1].gridloc, &new_comp.term[0].gridloc, sizeof(gridloc_t)) == 0) &&
-            (memcmp(&c->term[0].gridloc, &new_comp.term[1].gridloc, sizeof(gridloc_t)) == 0)) 
-        {
-            ERROR("new_comp overlaps existing component at %s %s\n",
-                  gridloc_to_str(&c->term[0].gridloc,s1),
-                  gridloc_to_str(&c->term[1].gridloc,s2));
-            timed_moving_average_free(new_comp.watts);
-            return -1;
+    // verify not overlapping with existing component; the components that 
+    // could overlap are those with a terminal on the new component's term[0] gridloc
+    g = grid_get(&new_comp.term[0].gridloc);
+    if (g) {
+        for (i = 0; i < g->max_term; i++) {
+            char s1[50], s2[50];
+            c = g->term[i]->component;
+            if (memcmp(&c->term[g->term[i]->termid ^ 1].gridloc, &new_comp.term[1].gridloc, sizeof(gridloc_t)) == 0) {
+                ERROR("new_comp overlaps existing component at %s %s\n",
+                      gridloc_to_str(&c->term[0].gridloc,s1),
+                      gridloc_to_str(&c->term[1].gridloc,s2));
+                waveform_free(&new_comp);
+                return -1;
+            }
         }
     }
 
@@ -876,20 +1101,26 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
     // - reset the model
     model_reset();
 
-    // - add new_comp to component list
+    // - add new_comp to component list, growing the component table if needed
+    if (idx == max_component) {
+        component_alloc();
+    }
     c = &component[idx];
     *c = new_comp;
+    c->term[0].component = c;
+    c->term[1].component = c;
     if (idx == max_component) {
         max_component++;
+    } else {
+        max_free_component--;
     }
 
-    // - add the new component to grid
+    // - add the new component to grid, adding its grid locations if needed
     for (i = 0; i < 2; i++) {
-        int32_t x = c->term[i].gridloc.x;
-        int32_t y = c->term[i].gridloc.y;
-        grid_t * g = &grid[x][y];
+        g = grid_alloc(&c->term[i].gridloc);
         if (g->max_term == MAX_GRID_TERM) {
-            FATAL("all terminals used on gridloc %s\n", g->glstr);
+            char s1[50];
+            FATAL("all terminals used on gridloc %s\n", gridloc_to_str(&c->term[i].gridloc,s1));
             return -1;
         }
         g->term[g->max_term++] = &c->term[i];
@@ -900,8 +1131,13 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
         }
     }
 
-    // - search grid to identify the ground locations
-    identify_grid_ground(NULL);
+    // - join the grid locations connected by a wire in the grid's union-find
+    if (c->type == COMP_WIRE) {
+        grid_union(c->term[0].gridloc, c->term[1].gridloc);
+    }
+
+    // - the netlist has changed
+    netlist_version++;
 
     // return success
     return 0;
@@ -909,17 +1145,17 @@ static int32_t add_component(char *type_str, char *gl0_str, char *gl1_str, char
 
 static int32_t del_component(char * comp_str)
 {
-    int32_t i, j;
+    int32_t i, j, idx;
     component_t *c = NULL;
 
     // locate the component to be deleted
-    for (i = 0; i < max_component; i++) {
-        c = &component[i];
+    for (idx = 0; idx < max_component; idx++) {
+        c = &component[idx];
         if (c->type != COMP_NONE && strcasecmp(c->comp_str, comp_str) == 0) {
             break;
         }
     }
-    if (i == max_component) {
+    if (idx == max_component) {
         ERROR("component '%s' does not exist\n", comp_str);
         return -1;
     }
@@ -931,13 +1167,13 @@ static int32_t del_component(char * comp_str)
 
     // - remove the component's 2 terminals from the grid
     for (i = 0; i < 2; i++) {
-        grid_t * g = &grid[c->term[i].gridloc.x][c->term[i].gridloc.y];
+        grid_t * g = grid_get(&c->term[i].gridloc);
         bool found = false;
         for (j = 0; j < g->max_term; j++) {
             if (g->term[j] == &c->term[i]) {
                 memmove(&g->term[j], 
-                        &g->term[j]+1,
-                        sizeof(gridloc_t) * (g->max_term - 1));
+                        &g->term[j+1],
+                        sizeof(terminal_t*) * (g->max_term - j - 1));
                 g->max_term--;
                 found = true;
                 break;
@@ -950,57 +1186,243 @@ static int32_t del_component(char * comp_str)
     //   grid has_remote_wire flag
     if (c->type == COMP_WIRE && c->wire.remote) {
         for (i = 0; i < 2; i++) {
-            grid_t * g = &grid[c->term[i].gridloc.x][c->term[i].gridloc.y];
+            grid_t * g = grid_get(&c->term[i].gridloc);
             assert(g->has_remote_wire);
             g->has_remote_wire = false;
         }
     }
 
-    // - free component power
-    timed_moving_average_free(c->watts);
+    // - free power supply wave form table
+    waveform_free(c);
+
+    // - if the component is a wire then the grid's union-find needs to be rebuilt
+    if (c->type == COMP_WIRE) {
+        grid_connectivity_stale = true;
+    }
+
+    // - the netlist has changed
+    netlist_version++;
 
-    // - remove from component list
+    // - remove from component list, and add its entry to the free stack
     c->type = COMP_NONE;
     memset(c, 0, sizeof(component_t));
-
-    // - search grid to identify ground locations that have possibly changed
-    //   as a result of the component's deletion
-    identify_grid_ground(NULL);
+    if (max_free_component == max_alloced_free_component) {
+        max_alloced_free_component = (max_alloced_free_component ? 2 * max_alloced_free_component : 1000);
+        free_component = realloc(free_component, max_alloced_free_component * sizeof(int32_t));
+        assert(free_component);
+    }
+    free_component[max_free_component++] = idx;
 
     // success0
     return 0;
 }
 
+static int32_t set_component_value(char * comp_str, char * value_str)
+{
+    int32_t idx, rc;
+    component_t new_value, *c = NULL;
+
+    // locate the component whose value is to be changed
+    for (idx = 0; idx < max_component; idx++) {
+        c = &component[idx];
+        if (c->type != COMP_NONE && strcasecmp(c->comp_str, comp_str) == 0) {
+            break;
+        }
+    }
+    if (idx == max_component) {
+        ERROR("component '%s' does not exist\n", comp_str);
+        return -1;
+    }
+
+    // only the values of resistors, capacitors, inductors, and power can be changed
+    if (c->type != COMP_RESISTOR && c->type != COMP_CAPACITOR && 
+        c->type != COMP_INDUCTOR && c->type != COMP_POWER) {
+        ERROR("the value of %s '%s' can not be changed\n", c->type_str, c->comp_str);
+        return -1;
+    }
+
+    // parse the new value into a copy of the component
+    new_value = *c;
+    rc = parse_component_value(&new_value, value_str);
+    if (rc < 0) {
+        return -1;
+    }
+
+    // the model_thread copies the new value to the component; the model is
+    // not reset, so a running model continues from the current model time
+    model_set_component_value(c, &new_value);
+
+    // success
+    return 0;
+}
+
+// parse value_str, and set the component's value fields
+static int32_t parse_component_value(component_t * c, char * value_str)
+{
+    int32_t rc, color;
+
+    switch (c->type) {
+    case COMP_WIRE:
+        value_str = strtok(value_str, ",");
+        if (value_str) {
+            if (strcasecmp(value_str,"remote") != 0) {
+                ERROR("invalid value '%s' for %s\n", value_str, c->type_str);
+                return -1;
+            }
+            value_str = strtok(NULL, "");
+            color = sdl_color(value_str);
+            if (color == -1) {
+                ERROR("invalid value '%s' for %s\n", value_str, c->type_str);
+                return -1;
+            }
+            c->wire.remote = true;
+            c->wire.remote_color = color;
+        }
+        break;
+    case COMP_POWER: {
+        // copy value_str for the error message, because waveform_parse
+        // modifies it; a long value is truncated in the message
+        char s[200];
+        snprintf(s, sizeof(s), "%s", value_str ? value_str : "");
+        rc = waveform_parse(c, value_str);
+        if (rc == -1) {
+            ERROR("invalid value '%s' for %s\n", s, c->type_str);
+            return -1;
+        }
+        break; }
+    case COMP_RESISTOR:
+        rc = str_to_val(value_str, UNITS_OHMS, &c->resistor.ohms);
+        if (rc == -1) {
+            ERROR("invalid value '%s' for %s\n", value_str, c->type_str);
+            return -1;
+        }
+        break;
+    case COMP_CAPACITOR:
+        rc = str_to_val(value_str, UNITS_FARADS, &c->capacitor.farads);
+        if (rc == -1) {
+            ERROR("invalid value '%s' for %s\n", value_str, c->type_str);
+            return -1;
+        }
+        break;
+    case COMP_INDUCTOR:
+        value_str = strtok(value_str, ",");
+        rc = str_to_val(value_str, UNITS_HENRYS, &c->inductor.henrys); 
+        if (rc == -1) {
+            ERROR("invalid value '%s' for %s\n", value_str, c->type_str);
+            return -1;
+        }
+        value_str = strtok(NULL, "");
+        if (value_str != NULL) {
+            rc = str_to_val(value_str, UNITS_AMPS, &c->inductor.i_init);
+            if (rc == -1) {
+                ERROR("invalid value '%s' for %s\n", value_str, c->type_str);
+                return -1;
+            }
+        }
+        break;
+    case COMP_DIODE:
+        break;
+    }
+
+    // success
+    return 0;
+}
+
 // -----------------  PUBLIC UTILS  -------------------------------------------------------------
 
-// convert gridloc to string
+// convert gridloc to string; the row (y) is represented by letters, 'a' to 'z'
+// followed by 'A' to 'Z' for rows 0 to 51, and then 'aa', 'ab', ... 'ZZ', 'aaa', ...;
+// the column (x) is represented by a number starting at 1
 char * gridloc_to_str(gridloc_t * gl, char * s)
 {
+    char letters[8];
+    int32_t n, i, digit;
+
     assert(gl->x >= 0 && gl->x < MAX_GRID_X);
     assert(gl->y >= 0 && gl->y < MAX_GRID_Y);
 
-    sprintf(s, "%c%d", 
-            gl->y + (gl->y < 26 ? 'a' : 'A' - 26),
-            gl->x + 1);
+    // the letters are the y value in bijective base 52, least significant last
+    i = sizeof(letters) - 1;
+    letters[i] = '\0';
+    n = gl->y + 1;
+    while (n > 0) {
+        digit = (n - 1) % 52;
+        letters[--i] = (digit < 26 ? 'a' + digit : 'A' + digit - 26);
+        n = (n - 1) / 52;
+    }
+
+    sprintf(s, "%s%d", letters+i, gl->x + 1);
     return s;
 }
 
+// returns the grid location gl, or NULL if gl has no terminal and is not 
+// the ground; the grid locations are found using a hash table of x,y
+grid_t * grid_get(gridloc_t * gl)
+{
+    grid_t * g;
+
+    if (max_grid_hash == 0) {
+        return NULL;
+    }
+    for (g = grid_hash[GRID_HASH(gl, max_grid_hash)]; g != NULL; g = g->hash_next) {
+        if (g->gl.x == gl->x && g->gl.y == gl->y) {
+            return g;
+        }
+    }
+    return NULL;
+}
+
+// returns the root grid location of the set of grid locations that are connected
+// to gl by wires; the grid locations on the path to the root are relinked to 
+// their grandparent (path halving), so this must be called with the display lock
+gridloc_t grid_find(gridloc_t gl)
+{
+    grid_t * g = grid_get(&gl);
+
+    // a grid location that is not in the grid is not connected to anything
+    if (g == NULL) {
+        return gl;
+    }
+    return grid_root(g)->gl;
+}
+
+// returns true if gl is connected to the ground by wires
+bool grid_is_ground(gridloc_t * gl)
+{
+    gridloc_t r0, r1;
+
+    if (!ground_is_set) {
+        return false;
+    }
+    r0 = grid_find(*gl);
+    r1 = grid_find(ground);
+    return r0.x == r1.x && r0.y == r1.y;
+}
+
 // convert string to gridloc, return -1 on error
 int32_t str_to_gridloc(char *glstr, gridloc_t * gl)
 {
-    int32_t x=-1, y=-1;
+    int64_t x=-1, y=0;
+    char *p;
 
     if (glstr == NULL) {
         return -1;
     }
 
-    if (glstr[0] >= 'a' && glstr[0] <= 'z') {
-        y = glstr[0] - 'a';
-    } else if (glstr[0] >= 'A' && glstr[0] <= 'Z') {
-        y = glstr[0] - 'A' + 26;
+    for (p = glstr; *p != '\0' && y <= MAX_GRID_Y; p++) {
+        if (*p >= 'a' && *p <= 'z') {
+            y = y * 52 + (*p - 'a') + 1;
+        } else if (*p >= 'A' && *p <= 'Z') {
+            y = y * 52 + (*p - 'A' + 26) + 1;
+        } else {
+            break;
+        }
     }
+    y--;
 
-    sscanf(glstr+1, "%d", &x);
+    if (p == glstr || sscanf(p, "%ld", &x) != 1) {
+        return -1;
+    }
     x--;
 
     if (y < 0 || y >= MAX_GRID_Y || x < 0 || x >= MAX_GRID_X) {
@@ -1012,22 +1434,15 @@ int32_t str_to_gridloc(char *glstr, gridloc_t * gl)
     return 0;
 }
 
-// convert component to value string
-char * component_to_value_str(component_t * c, char *s)
+// convert component to value string, of at most size chars including the
+// terminating nul; only the power supply value can be long
+char * component_to_value_str(component_t * c, char *s, int32_t size)
 {
-    int32_t len;
-
     s[0] = '\0';
 
     switch (c->type) {
     case COMP_POWER:
-        val_to_str(c->power.volts, UNITS_VOLTS, s, true);
-        if (c->power.hz > 0) {
-            len = strlen(s);
-            strcpy(s+len, ",");
-            val_to_str(c->power.hz, UNITS_HZ, s+len+1, true);
-        }
-        // XXX alsw wave form
+        waveform_to_str(c, s, size);
         break;
     case COMP_RESISTOR:
         val_to_str(c->resistor.ohms, UNITS_OHMS, s, true);
@@ -1052,17 +1467,20 @@ char * component_to_value_str(component_t * c, char *s)
     return s;
 }
 
-// convert component to full string
-char * component_to_full_str(component_t * c, char * s)
+// convert component to full string, of at most size chars
+char * component_to_full_str(component_t * c, char * s, int32_t size)
 {
-    char *p, s1[100], s2[100];
+    char s1[100], s2[100];
+    int32_t len;
 
-    p = s;
-    p += sprintf(p, "%-10s %-4s %-4s ",
-                 c->type_str,
-                 gridloc_to_str(&c->term[0].gridloc, s1),
-                 gridloc_to_str(&c->term[1].gridloc, s2));
-    component_to_value_str(c, p);
+    len = snprintf(s, size, "%-10s %-4s %-4s ",
+                   c->type_str,
+                   gridloc_to_str(&c->term[0].gridloc, s1),
+                   gridloc_to_str(&c->term[1].gridloc, s2));
+    if (len >= size) {
+        return s;
+    }
+    component_to_value_str(c, s+len, size-len);
 
     return s;
 }
@@ -1250,6 +1668,7 @@ static void param_init(void)
     PARAM_CREATE(PARAM_VOLTAGE,       "voltage",       "on"       );
     PARAM_CREATE(PARAM_COMPONENT,     "component",     "value"    );
     PARAM_CREATE(PARAM_INTERMEDIATE,  "intermediate",  "off"      );
+    PARAM_CREATE(PARAM_MULTIRATE,     "multirate",     "0"        );
 
     PARAM_CREATE(PARAM_CENTER,        "center",        "c3"       );
     PARAM_CREATE(PARAM_SCALE,         "scale",         "200"      );
@@ -1292,15 +1711,13 @@ int32_t param_set(int32_t id, char *str_val)
     if ((id == PARAM_SCALE ||
          id == PARAM_SCOPE_TRIGGER ||
          id == PARAM_STEP_COUNT) &&
-        (sscanf(str_val, "%Lf", &num_val) != 1))
+        ((sscanf(str_val, "%Lf", &num_val) != 1) ||
+         (id == PARAM_SCALE && (num_val < MIN_GRID_SCALE || num_val > MAX_GRID_SCALE)) ||
+         (id == PARAM_SCOPE_TRIGGER && (num_val != 0 && num_val != 1)) || 
+         (id == PARAM_STEP_COUNT && (num_val <= 0))))
     {
-        if ((id == PARAM_SCALE && (num_val < MIN_GRID_SCALE || num_val > MAX_GRID_SCALE)) ||
-            (id == PARAM_SCOPE_TRIGGER && (num_val != 0 && num_val != 1)) || 
-            (id == PARAM_STEP_COUNT && (num_val <= 0)))
-        {
-            ERROR("failed to set '%s', invalid numeric value\n", param_name(id));
-            return -1;
-        }
+        ERROR("failed to set '%s', invalid numeric value\n", param_name(id));
+        return -1;
     }
 
     // check for params whose value must be 'on' or 'off'
@@ -1315,6 +1732,16 @@ int32_t param_set(int32_t id, char *str_val)
         return -1;
     }
 
+    // check PARAM_MULTIRATE, 0 is off, otherwise the ratio of the slow
+    // partition's step to delta_t
+    if ((id == PARAM_MULTIRATE) &&
+        ((sscanf(str_val, "%Lf", &num_val) != 1) || 
+         (num_val < 0 || num_val > 1000000 || num_val != (int32_t)num_val)))
+    {
+        ERROR("failed to set '%s', expected integer 0 to 1000000\n", param_name(id));
+        return -1;
+    }
+
     // check PARAM_COMPONENT
     if ((id == PARAM_COMPONENT) &&
         (strcasecmp(str_val, "value") != 0 && 
@@ -1396,6 +1823,23 @@ int32_t param_set(int32_t id, char *str_val)
     param[id].num_val = num_val;
     param[id].update_count++;
 
+    // if this param is used by the model_thread then publish a new 
+    // solver_config snapshot, and wake the model_thread because it 
+    // also acts on the scope params while idle; the scope_a..p params are
+    // included because the model_thread resolves these to probes
+    if (id == PARAM_DELTA_T ||
+        id == PARAM_DCPWR_RAMP ||
+        id == PARAM_INTERMEDIATE ||
+        id == PARAM_MULTIRATE ||
+        id == PARAM_SCOPE_MODE ||
+        id == PARAM_SCOPE_TRIGGER ||
+        id == PARAM_SCOPE_SPAN_T ||
+        (id >= PARAM_SCOPE_A && id < PARAM_SCOPE_A + MAX_SCOPE))
+    {
+        publish_solver_config();
+        model_wakeup();
+    }
+
     // return success
     return 0;
 }
@@ -1442,75 +1886,222 @@ int32_t param_update_count(int32_t id)
     return param[id].update_count;
 }
 
-// -----------------  PRIVATE UTILS  ------------------------------------------------------------
+// the solver_config is protected by a sequence lock: solver_config_seq is odd 
+// while the solver_config is being updated, and the solver_config version is 
+// the value of solver_config_seq when the update completed
+void param_get_solver_config(solver_config_t * cfg)
+{
+    uint64_t seq;
 
-static void identify_grid_ground(gridloc_t *gl)
+    while (true) {
+        seq = __atomic_load_n(&solver_config_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        *cfg = solver_config;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&solver_config_seq, __ATOMIC_RELAXED) == seq) {
+            break;
+        }
+    }
+    cfg->version = seq;
+}
+
+uint64_t param_solver_config_version(void)
 {
-    #define MAX_GROUND_GRIDLOC 500
-    static gridloc_t ground_gridloc[MAX_GROUND_GRIDLOC];
-    static int32_t max_ground_gridloc;
+    return __atomic_load_n(&solver_config_seq, __ATOMIC_ACQUIRE);
+}
 
-    grid_t *g;
-    int32_t i;
+static void publish_solver_config(void)
+{
+    // param_set can be called by the cli, display, and model threads; 
+    // so serialize the updates
+    pthread_mutex_lock(&solver_config_mutex);
 
-    // if this is the first_call (not the recursive call) then
-    if (gl == NULL) {
-        // clear the pre-existing grid ground flags
-        for (i = 0; i < max_ground_gridloc; i++) {
-            int32_t x = ground_gridloc[i].x;
-            int32_t y = ground_gridloc[i].y;
-            assert(grid[x][y].ground);
-            grid[x][y].ground = false;
-        }
-        max_ground_gridloc = 0;
+    __atomic_store_n(&solver_config_seq, solver_config_seq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
 
-        // if ground is not set then return
-        if (!ground_is_set) {
-            return;
+    solver_config.delta_t          = param[PARAM_DELTA_T].num_val;
+    solver_config.scope_span_t     = param[PARAM_SCOPE_SPAN_T].num_val;
+    solver_config.scope_trigger    = (param[PARAM_SCOPE_TRIGGER].num_val == 1);
+    solver_config.scope_continuous = (strcasecmp(param[PARAM_SCOPE_MODE].str_val, "continuous") == 0);
+    solver_config.dcpwr_ramp       = (strcasecmp(param[PARAM_DCPWR_RAMP].str_val, "on") == 0);
+    solver_config.intermediate     = (strcasecmp(param[PARAM_INTERMEDIATE].str_val, "on") == 0);
+    solver_config.multirate        = param[PARAM_MULTIRATE].num_val;
+
+    __atomic_store_n(&solver_config_seq, solver_config_seq+1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&solver_config_mutex);
+}
+
+// -----------------  PRIVATE UTILS  ------------------------------------------------------------
+
+// returns the root of the set of g in the grid's union-find, see grid_find
+static grid_t * grid_root(grid_t * g)
+{
+    while (g->uf_parent) {
+        if (g->uf_parent->uf_parent) {
+            g->uf_parent = g->uf_parent->uf_parent;
         }
+        g = g->uf_parent;
+    }
+    return g;
+}
+
+// join the sets of the 2 grid locations in the grid's union-find; the 
+// grid locations must be in the grid
+static void grid_union(gridloc_t gl0, gridloc_t gl1)
+{
+    grid_t *g0, *g1, *tmp;
 
-        // set gl to the 'ground' gridloc
-        gl = &ground;
+    g0 = grid_root(grid_get(&gl0));
+    g1 = grid_root(grid_get(&gl1));
+    if (g0 == g1) {
+        return;
     }
 
-    // set this grid location's ground flag, and
-    // add to list of ground_gridloc
-    g = &grid[gl->x][gl->y];
-    g->ground = true;
-    assert(max_ground_gridloc < MAX_GROUND_GRIDLOC);
-    ground_gridloc[max_ground_gridloc++] = *gl;
+    // union by rank, the root with the lower rank is linked to the other root
+    if (g0->uf_rank < g1->uf_rank) {
+        tmp = g0; g0 = g1; g1 = tmp;
+    }
+    g1->uf_parent = g0;
+    if (g0->uf_rank == g1->uf_rank) {
+        g0->uf_rank++;
+    }
+}
+
+// rebuild the grid's union-find, if a wire has been deleted since it was last
+// built; wires that are added are joined in the union-find when they are added,
+// but the union-find can not remove a wire, so it is rebuilt from all of the wires;
+// this is deferred until the union-find is needed by the display or the model,
+// so that it is done once when a circuit file that deletes wires is read
+static void grid_connectivity_update(void)
+{
+    int32_t i;
 
-    // loop over this grid location's terminals;
-    // if the terminal is a WIRE then determine the
-    // gridloc on the other side of the wire and 
-    // call identify_grid_ground for that gridloc
-    for (i = 0; i < g->max_term; i++) {
-        component_t * c = g->term[i]->component;
+    if (!grid_connectivity_stale) {
+        return;
+    }
+
+    for (i = 0; i < max_grid; i++) {
+        grid[i]->uf_parent = NULL;
+        grid[i]->uf_rank = 0;
+    }
+    for (i = 0; i < max_component; i++) {
+        component_t * c = &component[i];
         if (c->type == COMP_WIRE) {
-            int32_t      other_term_id = (g->term[i]->termid ^ 1);
-            terminal_t * other_term = &c->term[other_term_id];
-            gridloc_t  * other_gl = &other_term->gridloc;
-            grid_t     * other_g = &grid[other_gl->x][other_gl->y];
-            if (other_g->ground == false)  {
-                identify_grid_ground(other_gl);
-            }
+            grid_union(c->term[0].gridloc, c->term[1].gridloc);
         }
     }
+    grid_connectivity_stale = false;
 }
 
 static void grid_init()
 {
-    int32_t glx, gly;
-    char s[100];
+    int32_t i;
+
+    // free the grid, grid[i] is the start of a block when i is a multiple of GRID_BLOCK
+    for (i = 0; i < max_grid; i += GRID_BLOCK) {
+        free(grid[i]);
+    }
+    free(grid);
+    free(grid_hash);
+    grid = NULL;
+    grid_hash = NULL;
+    max_grid = 0;
+    max_alloced_grid = 0;
+    max_grid_hash = 0;
+}
 
-    // clear the grid
-    memset(&grid, 0, sizeof(grid));
+// returns the grid location gl, adding it to the grid if it is not already
+// there; only the grid locations that are used are allocated, so the memory
+// needed depends on the number of components and not on their x,y; when the 
+// table of grid locations is full it is doubled, and the hash table is rebuilt
+// with twice as many buckets as grid locations; the model must be reset, 
+// because the model_thread accesses the grid while running, and the display 
+// lock must be held
+static grid_t * grid_alloc(gridloc_t * gl)
+{
+    grid_t * g;
+    int32_t i, h;
+
+    // if gl is already in the grid then return it
+    g = grid_get(gl);
+    if (g != NULL) {
+        return g;
+    }
+
+    // grow the table of grid locations and the hash table, if needed
+    if (max_grid == max_alloced_grid) {
+        max_alloced_grid = (max_alloced_grid ? 2 * max_alloced_grid : 1000);
+        grid = realloc(grid, max_alloced_grid * sizeof(grid_t *));
+        assert(grid);
+
+        free(grid_hash);
+        max_grid_hash = 2 * max_alloced_grid;
+        grid_hash = calloc(max_grid_hash, sizeof(grid_t *));
+        assert(grid_hash);
+        for (i = 0; i < max_grid; i++) {
+            h = GRID_HASH(&grid[i]->gl, max_grid_hash);
+            grid[i]->hash_next = grid_hash[h];
+            grid_hash[h] = grid[i];
+        }
+    }
+
+    // add gl to the grid, allocating a new block of grid locations if needed
+    if (max_grid % GRID_BLOCK == 0) {
+        g = calloc(GRID_BLOCK, sizeof(grid_t));
+        assert(g);
+    } else {
+        g = grid[max_grid-1] + 1;
+    }
+    g->gl = *gl;
+    h = GRID_HASH(gl, max_grid_hash);
+    g->hash_next = grid_hash[h];
+    grid_hash[h] = g;
+    grid[max_grid++] = g;
+    return g;
+}
+
+// grow the component table so that it has room for at least one more component;
+// the pointers to the components and their terminals are relocated to the new
+// table; the model must be reset, so that the nodes and probes do not reference
+// the components, and the display lock must be held
+static void component_alloc(void)
+{
+    int32_t new_max_alloced_component, i, j;
+    grid_t * g;
 
-    // reset the grid's gridloc strings
-    for (glx = 0; glx < MAX_GRID_X; glx++) {
-        for (gly = 0; gly < MAX_GRID_Y; gly++) {
-            gridloc_t gl = {glx, gly};
-            strcpy(grid[glx][gly].glstr, gridloc_to_str(&gl,s));
+    // if there is room then return
+    if (max_component < max_alloced_component) {
+        return;
+    }
+
+    // convert the grid's terminal pointers to offsets within the component table
+    for (i = 0; i < max_grid; i++) {
+        g = grid[i];
+        for (j = 0; j < g->max_term; j++) {
+            g->term[j] = (terminal_t*)((char*)g->term[j] - (char*)component);
+        }
+    }
+
+    // reallocate the component table, and clear the added entries
+    new_max_alloced_component = (max_alloced_component ? 2 * max_alloced_component : 1000);
+    component = realloc(component, new_max_alloced_component * sizeof(component_t));
+    assert(component);
+    memset(&component[max_alloced_component], 0, 
+           (new_max_alloced_component - max_alloced_component) * sizeof(component_t));
+    max_alloced_component = new_max_alloced_component;
+
+    // relocate the terminals' component pointers, and the grid's terminal pointers
+    for (i = 0; i < max_component; i++) {
+        component[i].term[0].component = &component[i];
+        component[i].term[1].component = &component[i];
+    }
+    for (i = 0; i < max_grid; i++) {
+        g = grid[i];
+        for (j = 0; j < g->max_term; j++) {
+            g->term[j] = (terminal_t*)((char*)component + (uintptr_t)g->term[j]);
         }
     }
 }
@@ -26,17 +26,57 @@ SOFTWARE.
 // defines
 //
 
+// request the model_thread to transition to state x, and wait for the
+// model_thread to acknowledge; the model_thread signals model_cond when
+// it changes model_state, so this returns within microseconds
 #define SET_MODEL_REQ(x) \
     do { \
+        pthread_mutex_lock(&model_mutex); \
         model_state_req = (x); \
-        __sync_synchronize(); \
+        pthread_cond_broadcast(&model_cond); \
         while (model_state != model_state_req) { \
-            usleep(1000); \
+            pthread_cond_wait(&model_cond, &model_mutex); \
         } \
+        pthread_mutex_unlock(&model_mutex); \
     } while (0)
 
 #define DCPWR_RAMP_T 0.25e-3    // 0.25ms
 
+// after landing on a power supply breakpoint the model restarts with 
+// delta_t reduced by this factor, and then doubles delta_t each step
+#define BREAKPOINT_RESTART_FACTOR 16
+
+// perf counter, used to time the solver's phases; on x86 this is the cpu's
+// time stamp counter, which is read in a few ns, otherwise a ns clock
+#if defined(__x86_64__) || defined(__i386__)
+#define PERF_COUNTER() __builtin_ia32_rdtsc()
+#else
+#define PERF_COUNTER() \
+    ({ struct timespec _ts; \
+       clock_gettime(CLOCK_MONOTONIC, &_ts); \
+       (uint64_t)_ts.tv_sec * 1000000000 + _ts.tv_nsec; })
+#endif
+
+// reading the perf counter costs 10 to 20 ns, which is significant compared
+// with the phases of a small circuit; so only 1 of every PERF_SAMPLE_INTERVAL
+// steps is timed
+#define PERF_SAMPLE_INTERVAL 16
+
+// if this step is sampled then add the ticks since perf_t to the phase, 
+// and restart perf_t
+#define PERF_PHASE_DONE(phase) \
+    do { \
+        if (perf_sample) { \
+            uint64_t _now = PERF_COUNTER(); \
+            perf_ticks[phase] += _now - perf_t; \
+            perf_t = _now; \
+        } \
+    } while (0)
+
+// multirate: a node is in the slow partition when its time constant is at
+// least this many times the slow partition's step
+#define MULTIRATE_MIN_TAU_STEPS 100
+
 #define MAX_DIODE_OHMS 1e8L
 #define MIN_DIODE_OHMS .1L
 
@@ -45,27 +85,95 @@ SOFTWARE.
 // typedefs
 //
 
+// the nodes and components that are evaluated together by eval_partition
+typedef struct {
+    node_t      ** node;
+    int32_t        max_node;
+    int32_t        max_alloced_node;
+    component_t ** comp;
+    int32_t        max_comp;
+    int32_t        max_alloced_comp;
+} partition_t;
+
 //
 // variables
 //
 
-static int32_t     model_state_req;
-static int32_t     model_step_count;
-static long double auto_delta_t;
+static int32_t         model_state_req;
+static int32_t         model_wakeup_count;
+static pthread_mutex_t model_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  model_cond  = PTHREAD_COND_INITIALIZER;
+static int32_t         model_step_count;
+static long double     auto_delta_t;
+static solver_config_t config;  // model_thread's copy of the solver config
+static long double     next_breakpoint_t;
+static long double     restart_delta_t;
+static component_t   * component_value_req;      // see model_set_component_value
+static component_t   * component_value_req_new;
+
+static uint64_t         update_count;
+
+static uint64_t         total_steps;       // since the model was run
+static uint64_t         total_iterations;  // of eval_circuit_for_delta_t's loop
+static int32_t          max_iterations;    // for a single step
+static uint64_t         perf_ticks[MAX_PERF_PHASE];
+static uint64_t         perf_total_ticks;
+static uint64_t         perf_ticks_per_sec;
+static uint64_t         perf_t;
+static uint64_t         perf_sampled_steps;
+static bool             perf_sample;
+static uint64_t         iteration_hist[MAX_PERF_HIST];
+
+// multirate: the circuit is divided into the fast partition, which is 
+// evaluated every step, and the slow partition, which is evaluated for a 
+// step of multirate times delta_t, see multirate_partition; when multirate 
+// is off the fast partition is the entire circuit
+static partition_t      fast;
+static partition_t      slow;
+static bool             multirate_valid;  // the partitions are valid
+static bool             slow_active;      // a slow step is in progress
+static long double      slow_start_t;
+static long double      slow_delta_t;
+static long double      slow_restart_delta_t;
+static uint64_t         total_slow_steps;
+
+static model_snapshot_t snapshot;
+static uint64_t         snapshot_seq;
+static int32_t          snapshot_req;
+static pthread_mutex_t  snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// the compiled netlist; the nodes are retained after the model is reset, 
+// and are recompiled by model_run only when netlist_version has changed
+static bool             netlist_compiled;
+static uint64_t         netlist_compiled_version;
+static int32_t          netlist_max_node;
+static terminal_t    ** netlist_term;  // arena for the nodes' term lists
+static int32_t          max_alloced_netlist_term;
 
 //
 // prototypes
 //
   
 static int32_t init_nodes(void);
+static void clear_nodes(void);
 static node_t * allocate_node(void);
-static void add_terms_to_node(node_t *node, gridloc_t *gl);
 static void debug_print_nodes(void);
 static void reset(void);
 static void * model_thread(void * cx);
+static void model_thread_set_req(int32_t req);
+static void model_thread_wait(void);
+static void set_component_value(component_t * c, component_t * new_value);
+static void multirate_partition(long double delta_t_nominal);
+static void multirate_begin_step(long double delta_t_nominal);
+static void partition_add_node(partition_t * p, node_t * n);
+static void partition_add_comp(partition_t * p, component_t * c);
 static void eval_circuit_for_delta_t(void);
-static bool circuit_is_stable(int32_t count);
+static void eval_power_voltages(void);
+static int32_t eval_partition(partition_t * p, long double dt);
+static bool circuit_is_stable(partition_t * p, int32_t count);
 static long double get_comp_power_voltage(component_t * c);
+static long double get_next_breakpoint(void);
+static void publish_snapshot(bool intermediate);
 
 // -----------------  PUBLIC ---------------------------------------------------------
 
@@ -89,6 +197,7 @@ int32_t model_reset(void)
 
     // reset model variables
     reset();
+    publish_snapshot(false);
 
     // success
     return 0;
@@ -102,12 +211,22 @@ int32_t model_run(void)
     // reset the model
     reset();
 
-    // analyze the grid and components to create list of nodes;
-    // if this fails then reset the model variables
-    rc = init_nodes();
-    if (rc < 0) {
-        reset();
-        return -1;
+    // analyze the grid and components to create list of nodes, unless the
+    // nodes compiled by a prior run are still valid;
+    // if this fails then clear the nodes and reset the model variables
+    if (netlist_compiled && netlist_compiled_version == netlist_version) {
+        max_node = netlist_max_node;
+    } else {
+        clear_nodes();
+        rc = init_nodes();
+        if (rc < 0) {
+            clear_nodes();
+            reset();
+            return -1;
+        }
+        netlist_compiled = true;
+        netlist_compiled_version = netlist_version;
+        netlist_max_node = max_node;
     }
 
     // auto_delta_t will be used by the circuit sim model if the delta_t param is 
@@ -132,8 +251,8 @@ int32_t model_run(void)
         if (c->type != COMP_POWER) {
             continue;
         }
-        if (c->power.hz > largest_hz) {
-            largest_hz = c->power.hz;
+        if (waveform_hz(c) > largest_hz) {
+            largest_hz = waveform_hz(c);
         }
     }
     auto_delta_t = (largest_hz == -1 ? 0    :
@@ -143,8 +262,13 @@ int32_t model_run(void)
         auto_delta_t = param_num_val(PARAM_SCOPE_SPAN_T) / MAX_HISTORY;
     }
 
+    // clear the probe history; the finest resolution of the history is 
+    // the delta_t that the model is started with
+    probe_reset_history(param_num_val(PARAM_DELTA_T) ? param_num_val(PARAM_DELTA_T) : auto_delta_t);
+
     // set model stop time
     stop_t = param_num_val(PARAM_RUN_T);
+    publish_snapshot(false);
 
     // set the model state to RUNNING
     SET_MODEL_REQ(MODEL_STATE_RUNNING);
@@ -184,12 +308,25 @@ int32_t model_cont(void)
 
 int32_t model_step(void)
 {
+    // if a prior step is still in progress then wait for the model_thread to
+    // transition to STOPPED, this allows scripts to issue back to back step
+    // commands; the step is in progress until the transition, which follows
+    // the model_thread decrementing model_step_count to 0 and requesting it
+    pthread_mutex_lock(&model_mutex);
+    while (model_state == MODEL_STATE_RUNNING &&
+           (__atomic_load_n(&model_step_count, __ATOMIC_ACQUIRE) > 0 ||
+            model_state_req != MODEL_STATE_RUNNING)) 
+    {
+        pthread_cond_wait(&model_cond, &model_mutex);
+    }
+    pthread_mutex_unlock(&model_mutex);
+
     if (model_state != MODEL_STATE_STOPPED && model_state != MODEL_STATE_RESET) {
         ERROR("model state is not stopped or reset\n");
         return -1;
     }
 
-    model_step_count = param_num_val(PARAM_STEP_COUNT);
+    __atomic_store_n(&model_step_count, param_num_val(PARAM_STEP_COUNT), __ATOMIC_RELEASE);
     if (model_state == MODEL_STATE_RESET) {
         model_run();
     } else {
@@ -199,26 +336,156 @@ int32_t model_step(void)
     return 0;
 }
 
+// block until the model is not running, for example when the run has reached
+// its stop time; the model_thread signals model_cond when it changes model_state,
+// and publishes the snapshot beforehand, so the caller's next snapshot has the
+// final values of the run; if timeout_us is non zero and the model is still
+// running after timeout_us then -1 is returned
+int32_t model_wait_not_running(uint64_t timeout_us)
+{
+    struct timespec ts;
+    int32_t rc = 0;
+
+    // model_cond uses the default CLOCK_REALTIME for pthread_cond_timedwait
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_us / 1000000;
+    ts.tv_nsec += (timeout_us % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&model_mutex);
+    while (model_state == MODEL_STATE_RUNNING) {
+        if (timeout_us == 0) {
+            pthread_cond_wait(&model_cond, &model_mutex);
+        } else if (pthread_cond_timedwait(&model_cond, &model_mutex, &ts) == ETIMEDOUT) {
+            rc = (model_state == MODEL_STATE_RUNNING ? -1 : 0);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&model_mutex);
+
+    return rc;
+}
+
+// change the value of a resistor, capacitor, inductor, or power component, 
+// without resetting the model; the value is copied from new_value by the 
+// model_thread between delta_t steps, and the caller waits for this to be 
+// done, so the model_thread never evaluates a partially changed component
+void model_set_component_value(component_t * c, component_t * new_value)
+{
+    pthread_mutex_lock(&model_mutex);
+    component_value_req = c;
+    component_value_req_new = new_value;
+    pthread_cond_broadcast(&model_cond);
+    while (component_value_req != NULL) {
+        pthread_cond_wait(&model_cond, &model_mutex);
+    }
+    pthread_mutex_unlock(&model_mutex);
+}
+
+// copy the most recently published snapshot of the circuit values, and 
+// request the model_thread to publish a new snapshot at the end of its 
+// next time step; this does not block the model_thread
+void model_get_snapshot(model_snapshot_t * snap)
+{
+    uint64_t seq;
+    int32_t nn, nc;
+
+    while (true) {
+        seq = __atomic_load_n(&snapshot_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        nn = snapshot.max_node;
+        nc = snapshot.max_component;
+        if (nn < 0 || nn > snapshot.max_alloced_node || nc < 0 || nc > snapshot.max_alloced_component) {
+            continue;
+        }
+        if (nn > snap->max_alloced_node) {
+            snap->v = realloc(snap->v, nn * sizeof(snap->v[0]));
+            assert(snap->v);
+            snap->max_alloced_node = nn;
+        }
+        if (nc > snap->max_alloced_component) {
+            snap->i = realloc(snap->i, nc * sizeof(snap->i[0]));
+            snap->watts = realloc(snap->watts, nc * sizeof(snap->watts[0]));
+            assert(snap->i && snap->watts);
+            snap->max_alloced_component = nc;
+        }
+        memcpy(snap, &snapshot, offsetof(model_snapshot_t, max_alloced_node));
+        memcpy(snap->v, snapshot.v, nn * sizeof(snapshot.v[0]));
+        memcpy(snap->i, snapshot.i, nc * sizeof(snapshot.i[0]));
+        memcpy(snap->watts, snapshot.watts, nc * sizeof(snapshot.watts[0]));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&snapshot_seq, __ATOMIC_RELAXED) == seq) {
+            break;
+        }
+    }
+    snap->max_node = nn;
+    snap->max_component = nc;
+
+    __atomic_store_n(&snapshot_req, 1, __ATOMIC_RELEASE);
+}
+
+// returns a count that is incremented on every time step and model state change, 
+// used by the display to determine if it needs to be redrawn
+uint64_t model_update_count(void)
+{
+    return __atomic_load_n(&update_count, __ATOMIC_RELAXED);
+}
+
+void model_wakeup(void)
+{
+    // wake the model_thread if it is idle, so that it will process 
+    // changes such as the scope_trigger param
+    pthread_mutex_lock(&model_mutex);
+    model_wakeup_count++;
+    pthread_cond_broadcast(&model_cond);
+    pthread_mutex_unlock(&model_mutex);
+}
+
 // -----------------  NODE INITIALIZATION  -------------------------------------------
 
 static int32_t init_nodes(void)
 {
-    int32_t i, j, ground_node_count, power_count;
+    int32_t i, j, ground_node_count, power_count, max_term;
     node_t * ground_node = NULL;
 
+    // grow the node table so that there is a node for each terminal of 
+    // the components other than wires, which is the most nodes that can be 
+    // created; the node table is not grown while the nodes are being created
+    // because the terminals and grid locations point to the nodes;
+    // likewise grow the arena that provides the nodes' term lists
+    max_term = 0;
+    for (i = 0; i < max_component; i++) {
+        if (component[i].type != COMP_NONE && component[i].type != COMP_WIRE) {
+            max_term += 2;
+        }
+    }
+    if (max_term > max_alloced_node) {
+        node = realloc(node, max_term * sizeof(node_t));
+        assert(node);
+        memset(&node[max_alloced_node], 0, (max_term - max_alloced_node) * sizeof(node_t));
+        max_alloced_node = max_term;
+    }
+    if (max_term > max_alloced_netlist_term) {
+        free(netlist_term);
+        netlist_term = malloc(max_term * sizeof(terminal_t*));
+        assert(netlist_term);
+        max_alloced_netlist_term = max_term;
+    }
+
     // create a list of nodes, eliminating the wire component;
     // so that each node provides a list of connected real components
     // such as resistors, capacitors, diodes etc.
     //
-    // loop over all components 
-    //   if the component is a WIRE then continue
-    //   loop over the component's terminals
-    //     if the terminal is already part of a node then continue;
-    //     allocate a new node;
-    //     call add_terms_to_node to add all terms on this gridloc, and
-    //      connected to this gridloc to the node;
-    //   endloop
-    // endloop
+    // the grid locations that are connected by wires are sets in the grid's 
+    // union-find, which is maintained by main.c as wires are added and deleted;
+    // a node is created for each set that has a terminal of a real component,
+    // and the node is linked to the root grid location of the set; the node's 
+    // terminals are counted here, and added below
     for (i = 0; i < max_component; i++) {
         component_t * c = &component[i];
         if (c->type == COMP_NONE || c->type == COMP_WIRE) {
@@ -226,11 +493,55 @@ static int32_t init_nodes(void)
         }
         for (j = 0; j < 2; j++) {
             terminal_t * term = &c->term[j];
-            if (term->node) {
+            gridloc_t root = grid_find(term->gridloc);
+            grid_t * rg = grid_get(&root);
+            if (rg->node == NULL) {
+                rg->node = allocate_node();
+                rg->node->ground = grid_is_ground(&root);
+            }
+            term->node = rg->node;
+            term->node->max_term++;
+            if (c->type == COMP_POWER && j == 0) {
+                term->node->power = term;
+            }
+        }
+    }
+
+    // assign each node its slice of the arena, and add the terminals
+    max_term = 0;
+    for (i = 0; i < max_node; i++) {
+        node[i].term = &netlist_term[max_term];
+        max_term += node[i].max_term;
+        node[i].max_term = 0;
+    }
+    for (i = 0; i < max_component; i++) {
+        component_t * c = &component[i];
+        if (c->type == COMP_NONE || c->type == COMP_WIRE) {
+            continue;
+        }
+        for (j = 0; j < 2; j++) {
+            node_t * n = c->term[j].node;
+            n->term[n->max_term++] = &c->term[j];
+        }
+    }
+
+    // link the other grid locations of the components' terminals, including 
+    // the wires' terminals, to the node of their set; there is no node when
+    // the set is connected only to wires
+    for (i = 0; i < max_component; i++) {
+        component_t * c = &component[i];
+        if (c->type == COMP_NONE) {
+            continue;
+        }
+        for (j = 0; j < 2; j++) {
+            gridloc_t * gl = &c->term[j].gridloc;
+            grid_t * g = grid_get(gl);
+            gridloc_t root;
+            if (g->node) {
                 continue;
             }
-            node_t * n = allocate_node();
-            add_terms_to_node(n, &c->term[j].gridloc);
+            root = grid_find(*gl);
+            g->node = grid_get(&root)->node;
         }
     }
 
@@ -295,77 +606,36 @@ static int32_t init_nodes(void)
     return 0;
 }
 
-static node_t * allocate_node(void)
-{
-    node_t * n;
-
-    assert(max_node < MAX_NODE);
-    n = &node[max_node++];
-
-    memset(&n->start_init_node_state, 
-           0,
-           sizeof(node_t) - offsetof(node_t,start_init_node_state));
-
-    return n;
-}
-
-static void add_terms_to_node(node_t *n, gridloc_t *gl)
+// clear the nodes, and the terminals' and grid locations' links to them;
+// this is done before the nodes are compiled, because the terminals and grid 
+// locations may still link to the nodes of the prior compile
+static void clear_nodes(void)
 {
     int32_t i;
-    grid_t *g;
 
-    // if this gridloc is already part of node then return
-    for (i = 0; i < n->max_gridloc; i++) {
-        if (gl->x == n->gridloc[i].x && gl->y == n->gridloc[i].y) {
-            return;
-        }
+    for (i = 0; i < max_component; i++) {
+        component[i].term[0].node = NULL;
+        component[i].term[1].node = NULL;
     }
 
-    // add this gridloc to the node
-    if (n->max_gridloc >= n->max_alloced_gridloc) {
-        n->max_alloced_gridloc = (n->max_gridloc == 0 ? 8 : n->max_gridloc * 2);
-        DEBUG("%ld: MAX_ALLOCED_GRIDLOC IS NOW %d\n", n-node, n->max_alloced_gridloc);
-        n->gridloc = realloc(n->gridloc, n->max_alloced_gridloc * sizeof(gridloc_t));
+    for (i = 0; i < max_grid; i++) {
+        grid[i]->node = NULL;
     }
-    n->gridloc[n->max_gridloc++] = *gl;
-
-    // add all terminals that are either direcctly connected to this gridloc or 
-    // are on other gridlocs that are connected to this gridloc
-    g = &grid[gl->x][gl->y];
-    for (i = 0; i < g->max_term; i++) {
-        terminal_t * term = g->term[i];
-        component_t * c = term->component;
-
-        if (c->type == COMP_WIRE) {
-            int32_t other_term_id = (term->termid ^ 1);
-            terminal_t * other_term = &c->term[other_term_id];
-            add_terms_to_node(n, &other_term->gridloc);
-        } else {
-            assert(term->node == NULL);
-
-            if (n->max_term >= n->max_alloced_term) {
-                n->max_alloced_term = (n->max_term == 0 ? 8 : n->max_term * 2);
-                DEBUG("%ld: MAX_ALLOCED_TERM IS NOW %d\n", n-node, n->max_alloced_term);
-                n->term = realloc(n->term, n->max_alloced_term * sizeof(terminal_t));
-            }
-            n->term[n->max_term] = term;
-            n->max_term++;
 
-            term->node = n;
+    max_node = 0;
+    netlist_max_node = 0;
+    netlist_compiled = false;
+}
 
-            if (term->component->type == COMP_POWER && term->termid == 0) {
-                n->power = term;
-            }
-        }
-    }
+static node_t * allocate_node(void)
+{
+    node_t * n;
 
-    // if this grid location is ground then set this node's ground flag
-    if (g->ground) {
-        n->ground = true;
-    }
+    assert(max_node < max_alloced_node);
+    n = &node[max_node++];
+    memset(n, 0, sizeof(node_t));
 
-    // link the grid location to this node
-    g->node = n;
+    return n;
 }
 
 static void debug_print_nodes(void)
@@ -380,26 +650,17 @@ static void debug_print_nodes(void)
     for (i = 0; i < max_node; i++) {
         node_t * n = &node[i];
 
-        INFO("node %d - max_gridloc=%d  max_term=%d  ground=%d  power=%p %s\n", 
-             i, n->max_gridloc, n->max_term, n->ground, n->power,
+        INFO("node %d - max_term=%d  ground=%d  power=%p %s\n", 
+             i, n->max_term, n->ground, n->power,
              n->power ? n->power->component->comp_str : "");
-        
-        p = s;
-        for (j = 0; j < n->max_gridloc; j++) {
-            char s1[100];
-            p += sprintf(p, "%s ", gridloc_to_str(&n->gridloc[j],s1));
-            if (p - s > MAX_DEBUG_STR - 100) {
-                strcpy(p, " ...");
-                break;
-            }
-        }
-        INFO("   gridlocs %s\n", s);
 
         p = s;
         for (j = 0; j < n->max_term; j++) {
-            p += sprintf(p, "copmid,term=%ld,%d ", 
+            char s1[100];
+            p += sprintf(p, "copmid,term,gl=%ld,%d,%s ", 
                          n->term[j]->component - component,
-                         n->term[j]->termid);
+                         n->term[j]->termid,
+                         gridloc_to_str(&n->term[j]->gridloc,s1));
             if (p - s > MAX_DEBUG_STR - 100) {
                 strcpy(p, " ...");
                 break;
@@ -411,13 +672,15 @@ static void debug_print_nodes(void)
 
 // -----------------  RESET  ---------------------------------------------------------
 
+// reset the model variables, and the node and component state; the nodes 
+// themselves are retained, see model_run
 static void reset(void)
 {
-    int32_t i, glx, gly;
+    int32_t i;
 
     SET_MODEL_REQ(MODEL_STATE_RESET);
 
-    for (i = 0; i < max_node; i++) {
+    for (i = 0; i < netlist_max_node; i++) {
         node_t *n = &node[i];
         memset(&n->start_init_node_state, 
                0,
@@ -430,29 +693,32 @@ static void reset(void)
             continue;
         }
 
-        c->term[0].node = NULL;
-        c->term[1].node = NULL;
-
         c->i_next = 0;
         c->i_now = 0;
         c->diode_ohms = MAX_DIODE_OHMS;
-        memset(c->i_history,0,sizeof(c->i_history));
-        timed_moving_average_reset(c->watts);
-    }
-
-    for (glx = 0; glx < MAX_GRID_X; glx++) {
-        for (gly = 0; gly < MAX_GRID_Y; gly++) {
-            grid[glx][gly].node = NULL;
-        }
+        windowed_average_reset(&c->watts);
     }
 
     model_t = 0;
     history_t = 0;
     stop_t = 0;
     delta_t = 0;
-    max_history = 0;
     max_node = 0;
     failed_to_stabilize_count = 0;
+    total_steps = 0;
+    total_iterations = 0;
+    max_iterations = 0;
+    memset(perf_ticks, 0, sizeof(perf_ticks));
+    perf_total_ticks = 0;
+    perf_sampled_steps = 0;
+    memset(iteration_hist, 0, sizeof(iteration_hist));
+    next_breakpoint_t = -1;
+    restart_delta_t = 0;
+    multirate_valid = false;
+    slow_active = false;
+    total_slow_steps = 0;
+    fast.max_node = fast.max_comp = 0;
+    slow.max_node = slow.max_comp = 0;
 
     for (i = 0; i < max_component; i++) {
         component_t *c = &component[i];
@@ -467,112 +733,572 @@ static void reset(void)
 
 static void * model_thread(void * cx) 
 {
-    #define SET_HISTORY(h,v) \
-        do { \
-            int32_t i; \
-            if (idx >= max_history) { \
-                for (i = max_history; i < idx; i++) { \
-                    h[i].min = h[i].max = NAN; \
-                } \
-                h[idx].min = h[idx].max = v; \
-            } else { \
-                if (v > h[idx].max) h[idx].max = v; \
-                if (v < h[idx].min) h[idx].min = v; \
-            } \
-        } while (0)
-
-    uint64_t i,idx;
-    long double last_scope_span_t = -1;
+    long double delta_t_nominal, remaining_t;
+    uint64_t step_start_t, start_us;
+    int32_t step_count;
+    bool landing;
+    solver_config_t prev_config;
+
+    param_get_solver_config(&config);
+
+    // determine the rate of the perf counter
+    start_us = microsec_timer();
+    step_start_t = PERF_COUNTER();
+    usleep(10000);
+    perf_ticks_per_sec = (PERF_COUNTER() - step_start_t) * 1000000 / 
+                         (microsec_timer() - start_us);
 
     while (true) {
-        // handle request to transition model_state
-        if (model_state_req != model_state) {
-            INFO("model_state is %s\n", MODEL_STATE_STR(model_state_req));
+        // if the solver config has been updated then get a new copy, and
+        // resolve the probes because the scope params may have changed; the
+        // multirate partition depends only on the multirate, delta_t and
+        // dcpwr_ramp params, so other changes such as the scope params don't
+        // cause the circuit to be repartitioned
+        if (param_solver_config_version() != config.version) {
+            prev_config = config;
+            param_get_solver_config(&config);
+            probe_resolve();
+            if (config.multirate != prev_config.multirate ||
+                config.delta_t != prev_config.delta_t ||
+                config.dcpwr_ramp != prev_config.dcpwr_ramp)
+            {
+                multirate_valid = false;
+            }
         }
-        model_state = model_state_req;
-        __sync_synchronize();
 
-        // if scope time span param has changed or scope trigger is requested 
-        // then reset scope history
-        if (param_num_val(PARAM_SCOPE_SPAN_T) != last_scope_span_t) {
-            last_scope_span_t = param_num_val(PARAM_SCOPE_SPAN_T);
-            history_t = model_t;
-            max_history = 0;
-            __sync_synchronize();
+        // handle request to transition model_state; the mutex is only 
+        // acquired when a transition has been requested, so that the 
+        // running model does not pay for it on every step
+        if (__atomic_load_n(&model_state_req, __ATOMIC_ACQUIRE) != model_state) {
+            pthread_mutex_lock(&model_mutex);
+            if (model_state_req != model_state) {
+                INFO("model_state is %s\n", MODEL_STATE_STR(model_state_req));
+                model_state = model_state_req;
+                probe_resolve();
+                publish_snapshot(false);
+                pthread_cond_broadcast(&model_cond);
+            }
+            pthread_mutex_unlock(&model_mutex);
+        }
+
+        // handle request to change a component's value
+        if (__atomic_load_n(&component_value_req, __ATOMIC_ACQUIRE) != NULL) {
+            pthread_mutex_lock(&model_mutex);
+            set_component_value(component_value_req, component_value_req_new);
+            component_value_req = NULL;
+            pthread_cond_broadcast(&model_cond);
+            pthread_mutex_unlock(&model_mutex);
         }
-        if (param_num_val(PARAM_SCOPE_TRIGGER) == 1) {
+
+        // if scope trigger is requested then the scope display starts at 
+        // the current model time; note that the probe history is retained,
+        // so the scope can be panned back to view the history prior to
+        // the trigger
+        if (config.scope_trigger) {
             param_set(PARAM_SCOPE_TRIGGER, "0");
             history_t = model_t;
-            max_history = 0;
-            __sync_synchronize();
         }
 
-        // if model is not running then continue
+        // if model is not running then wait for a state change request
+        // or a wakeup, and continue
         if (model_state != MODEL_STATE_RUNNING) {
-            usleep(1000);
+            model_thread_wait();
             continue;
         }
 
         // determine delta_t value
-        delta_t = param_num_val(PARAM_DELTA_T);
+        perf_sample = (total_steps % PERF_SAMPLE_INTERVAL) == 0;
+        if (perf_sample) {
+            step_start_t = PERF_COUNTER();
+            perf_sampled_steps++;
+        }
+        delta_t = config.delta_t;
         if (delta_t == 0) {
             delta_t = auto_delta_t;
             if (delta_t == 0) {
                 ERROR("param delta_t must be specified\n");
-                model_state_req = MODEL_STATE_STOPPED;   
+                model_thread_set_req(MODEL_STATE_STOPPED);
                 continue;
             }
         }
+        delta_t_nominal = delta_t;
+
+        // adjust delta_t so that the model lands exactly on the next power 
+        // supply breakpoint (such as a square wave or pulse edge), and 
+        // following a breakpoint restart with a small delta_t
+        // - if next_breakpoint_t has been reached then get the next one
+        if (next_breakpoint_t <= model_t) {
+            next_breakpoint_t = get_next_breakpoint();
+        }
+        // - use the restart_delta_t, which is doubled each step until it
+        //   reaches delta_t
+        if (restart_delta_t != 0) {
+            if (restart_delta_t < delta_t) {
+                delta_t = restart_delta_t;
+                restart_delta_t *= 2;
+            } else {
+                restart_delta_t = 0;
+            }
+        }
+        // - if the breakpoint is within this step then land on it; and if it
+        //   is within the next step then split the remaining time in half, 
+        //   to avoid a very short step to reach the breakpoint
+        landing = false;
+        remaining_t = next_breakpoint_t - model_t;
+        if (remaining_t <= delta_t) {
+            delta_t = remaining_t;
+            landing = true;
+        } else if (remaining_t < 2 * delta_t) {
+            delta_t = remaining_t / 2;
+        }
+
+        // partition the circuit, see multirate_partition; when multirate is 
+        // off the fast partition is the entire circuit; and if there is a slow
+        // partition then evaluate it when a slow step is to be started
+        if (!multirate_valid) {
+            multirate_partition(delta_t_nominal);
+        }
+        if (slow.max_node > 0 && !slow_active) {
+            multirate_begin_step(delta_t_nominal);
+        }
 
         // evaluate the circuit to determine the circuit values after
         // the circuit evolves for delta_t interval
         eval_circuit_for_delta_t();
 
-        // keep track of voltage and current history, 
-        // these are used for the scope display
-        idx = (model_t - history_t) / param_num_val(PARAM_SCOPE_SPAN_T) * MAX_HISTORY;
-        if (idx < MAX_HISTORY) {
-            for (i = 0; i < max_component; i++) {
-                component_t *c = &component[i];
-                if (c->type != COMP_NONE && c->type != COMP_WIRE) {
-                    SET_HISTORY(c->i_history, c->i_next);
-                }
-            }
-            for (i = 0; i < max_node; i++) {
-                node_t *n = &node[i];
-                SET_HISTORY(n->v_history, n->v_next);
-            }
-            __sync_synchronize();
-            max_history = idx + 1;
-            __sync_synchronize();
-        } else if (strcasecmp(param_str_val(PARAM_SCOPE_MODE), "continuous") == 0) {
+        // keep track of the history of the probed voltages and currents, 
+        // these are used for the scope display; in continuous mode the
+        // scope display restarts when the scope span has elapsed
+        if (perf_sample) {
+            perf_t = PERF_COUNTER();
+        }
+        probe_record(model_t);
+        PERF_PHASE_DONE(PERF_PHASE_PROBE);
+        if (config.scope_continuous && model_t - history_t >= config.scope_span_t) {
             history_t = model_t;
-            max_history = 0;
-            __sync_synchronize();
         }
 
-        // increment time
-        model_t += delta_t;
+        // increment time; when landing on a breakpoint set model_t to the 
+        // breakpoint time exactly, and start reducing delta_t
+        if (landing) {
+            model_t = next_breakpoint_t;
+            restart_delta_t = delta_t_nominal / BREAKPOINT_RESTART_FACTOR;
+        } else {
+            model_t += delta_t;
+        }
+        __atomic_add_fetch(&update_count, 1, __ATOMIC_RELAXED);
 
         // if model has reached the stop time, or 
         // has reached single step count then stop the model
-        if (model_t >= stop_t && model_step_count == 0) {
-            model_state_req = MODEL_STATE_STOPPED;   
+        step_count = __atomic_load_n(&model_step_count, __ATOMIC_ACQUIRE);
+        if (model_t >= stop_t && step_count == 0) {
+            model_thread_set_req(MODEL_STATE_STOPPED);
         }
-        if (model_step_count > 0) {
-            if (--model_step_count == 0) {
-                model_state_req = MODEL_STATE_STOPPED;   
+        if (step_count > 0) {
+            if (__atomic_sub_fetch(&model_step_count, 1, __ATOMIC_ACQ_REL) == 0) {
+                model_thread_set_req(MODEL_STATE_STOPPED);
             }
         }
+
+        if (perf_sample) {
+            perf_total_ticks += PERF_COUNTER() - step_start_t;
+        }
+
+        // if the display has requested a snapshot then publish it
+        if (__atomic_load_n(&snapshot_req, __ATOMIC_ACQUIRE)) {
+            publish_snapshot(false);
+        }
     }
     return NULL;
 }
 
+static void model_thread_set_req(int32_t req)
+{
+    // called by the model_thread to request its own state transition, 
+    // which is performed at the top of the model_thread loop
+    pthread_mutex_lock(&model_mutex);
+    model_state_req = req;
+    pthread_mutex_unlock(&model_mutex);
+}
+
+static void model_thread_wait(void)
+{
+    static int32_t last_wakeup_count;
+
+    // block until either a model state transition or component value change 
+    // is requested, or model_wakeup is called; no cpu is used while waiting
+    pthread_mutex_lock(&model_mutex);
+    while (model_state_req == model_state && 
+           component_value_req == NULL &&
+           model_wakeup_count == last_wakeup_count) {
+        pthread_cond_wait(&model_cond, &model_mutex);
+    }
+    last_wakeup_count = model_wakeup_count;
+    pthread_mutex_unlock(&model_mutex);
+}
+
+static void set_component_value(component_t * c, component_t * new_value)
+{
+    // the component's state, such as its current, is retained; when a power 
+    // component's wave form changes its next breakpoint is redetermined, 
+    // the model's auto_delta_t is not changed until the model is run again
+    switch (c->type) {
+    case COMP_POWER:
+        waveform_free(c);
+        c->power = new_value->power;
+        next_breakpoint_t = -1;
+        break;
+    case COMP_RESISTOR:
+        c->resistor = new_value->resistor;
+        break;
+    case COMP_CAPACITOR:
+        c->capacitor = new_value->capacitor;
+        break;
+    case COMP_INDUCTOR:
+        c->inductor = new_value->inductor;
+        break;
+    }
+
+    // the node time constants may have changed, so repartition the circuit
+    multirate_valid = false;
+}
+
+// -----------------  MULTIRATE  -----------------------------------------------------
+
+// Circuits that combine a fast part, which determines delta_t, with a part 
+// that has a very long time constant (such as a large capacitor charged through
+// a large resistor) need many iterations per step to stabilize, because the 
+// capacitor dominates the relaxation of its nodes. When the multirate param is 
+// greater than 1 the circuit is divided into two partitions:
+// - the slow partition: nodes whose RC time constant is at least 
+//   MULTIRATE_MIN_TAU_STEPS times the slow step (multirate * delta_t), and the
+//   resistive nodes that connect only to slow nodes, power or ground
+// - the fast partition: all other nodes
+// The slow partition is evaluated once per slow step, with the fast nodes held
+// at their current voltage. During the slow step the fast partition is evaluated
+// every delta_t, with the slow nodes' voltages linearly interpolated between the
+// start and end of the slow step.
+//
+// Nodes that connect to a diode or to a non DC power supply are always fast; and
+// so are nodes that connect to an inductor, because the voltage of such a node 
+// is not held by the inductor, and can change abruptly. While the DC power 
+// supplies are ramping, see param dcpwr_ramp, the circuit is not partitioned.
+
+static void multirate_partition(long double delta_t_nominal)
+{
+    int32_t i, j;
+    bool ramping, changed;
+    long double tau_limit;
+
+    fast.max_node = fast.max_comp = 0;
+    slow.max_node = slow.max_comp = 0;
+    slow_active = false;
+
+    // the partitions are redetermined after the dc power supply ramp completes
+    ramping = config.dcpwr_ramp && model_t < DCPWR_RAMP_T;
+    multirate_valid = !(config.multirate > 1 && ramping);
+    slow_restart_delta_t = delta_t_nominal;
+
+    // determine which nodes are slow, based on the node's time constant
+    tau_limit = MULTIRATE_MIN_TAU_STEPS * config.multirate * delta_t_nominal;
+    for (i = 0; i < max_node; i++) {
+        node_t * n = &node[i];
+        long double siemens=0, farads=0;
+        bool fast_only = false;
+
+        n->slow = false;
+        if (config.multirate <= 1 || ramping || n->power || n->ground) {
+            continue;
+        }
+
+        for (j = 0; j < n->max_term; j++) {
+            component_t *c = n->term[j]->component;
+            node_t *other_n = c->term[n->term[j]->termid ^ 1].node;
+
+            switch (c->type) {
+            case COMP_RESISTOR:
+                siemens += 1 / c->resistor.ohms;
+                break;
+            case COMP_CAPACITOR:
+                farads += c->capacitor.farads;
+                break;
+            case COMP_INDUCTOR:
+            case COMP_DIODE:
+                fast_only = true;
+                break;
+            }
+            if (other_n->power && other_n->power->component->power.wave_form != WAVE_FORM_DC) {
+                fast_only = true;
+            }
+        }
+        if (fast_only || siemens == 0 || farads == 0) {
+            continue;
+        }
+        n->slow = (farads / siemens >= tau_limit);
+    }
+
+    // a capacitor to a node other than power or ground does not slow down the
+    // common mode voltage of the two nodes, which follows the nodes' neighbors;
+    // so a node that has such a capacitor is fast, unless all of its neighbors
+    // are slow, power or ground
+    do {
+        changed = false;
+        for (i = 0; i < max_node; i++) {
+            node_t * n = &node[i];
+            bool floating_cap = false, fast_neighbor = false;
+
+            if (!n->slow) {
+                continue;
+            }
+
+            for (j = 0; j < n->max_term; j++) {
+                component_t *c = n->term[j]->component;
+                node_t *other_n = c->term[n->term[j]->termid ^ 1].node;
+
+                if (other_n->power || other_n->ground) {
+                    continue;
+                }
+                if (c->type == COMP_CAPACITOR) {
+                    floating_cap = true;
+                }
+                if (!other_n->slow) {
+                    fast_neighbor = true;
+                }
+            }
+            if (floating_cap && fast_neighbor) {
+                n->slow = false;
+                changed = true;
+            }
+        }
+    } while (changed);
+
+    // resistive nodes are also slow when all of their neighbors are either
+    // slow, power or ground, and at least one neighbor is slow
+    do {
+        changed = false;
+        for (i = 0; i < max_node; i++) {
+            node_t * n = &node[i];
+            bool has_slow = false, has_fast = false;
+
+            if (n->slow || config.multirate <= 1 || ramping || n->power || n->ground) {
+                continue;
+            }
+
+            for (j = 0; j < n->max_term; j++) {
+                component_t *c = n->term[j]->component;
+                node_t *other_n = c->term[n->term[j]->termid ^ 1].node;
+
+                if (c->type != COMP_RESISTOR) {
+                    has_fast = true;
+                    break;
+                }
+                if (other_n->slow) {
+                    has_slow = true;
+                } else if (!other_n->power && !other_n->ground) {
+                    has_fast = true;
+                    break;
+                }
+            }
+            if (has_slow && !has_fast) {
+                n->slow = true;
+                changed = true;
+            }
+        }
+    } while (changed);
+
+    // create the lists of nodes and components of each partition; a component
+    // is slow when both of its terminals connect to a slow node, power or ground;
+    // a component that connects a slow node to a fast node is in both partitions,
+    // because its current is needed to evaluate both nodes
+    for (i = 0; i < max_node; i++) {
+        node_t * n = &node[i];
+        partition_add_node(n->slow ? &slow : &fast, n);
+    }
+    for (i = 0; i < max_component; i++) {
+        component_t *c = &component[i];
+        node_t *n0 = c->term[0].node;
+        node_t *n1 = c->term[1].node;
+
+        c->slow = false;
+        if (c->type != COMP_RESISTOR &&
+            c->type != COMP_CAPACITOR &&
+            c->type != COMP_INDUCTOR &&
+            c->type != COMP_DIODE)
+        {
+            continue;
+        }
+
+        c->slow = (n0->slow || n1->slow) &&
+                  (n0->slow || n0->power || n0->ground) &&
+                  (n1->slow || n1->power || n1->ground);
+        if (n0->slow || n1->slow) {
+            partition_add_comp(&slow, c);
+        }
+        if (!c->slow) {
+            partition_add_comp(&fast, c);
+        }
+    }
+}
+
+static void multirate_begin_step(long double delta_t_nominal)
+{
+    int32_t i, count;
+
+    // evaluate the slow partition for the slow step, with the fast nodes held 
+    // at their current voltages; after the circuit is partitioned the slow step
+    // starts at delta_t and is doubled each slow step until it reaches multirate
+    // times delta_t, so that an abrupt change that the slow nodes do not hold,
+    // such as the common mode voltage of a floating capacitor at the start of 
+    // the run, is evaluated with a short step
+    if (perf_sample) {
+        perf_t = PERF_COUNTER();
+    }
+    slow_delta_t = config.multirate * delta_t_nominal;
+    if (slow_restart_delta_t < slow_delta_t) {
+        slow_delta_t = slow_restart_delta_t;
+        slow_restart_delta_t *= 2;
+    }
+    eval_power_voltages();
+    for (i = 0; i < fast.max_node; i++) {
+        fast.node[i]->dv_dt = 0;
+    }
+    count = eval_partition(&slow, slow_delta_t);
+    total_iterations += count;
+    total_slow_steps++;
+
+    // save the slow nodes' voltages at the start and end of the slow step, these
+    // are interpolated by eval_circuit_for_delta_t; and commit the slow 
+    // components' currents
+    for (i = 0; i < slow.max_node; i++) {
+        node_t * n = slow.node[i];
+        n->v_slow_start = n->v_now;
+        n->v_slow_end = n->v_next;
+    }
+    for (i = 0; i < slow.max_comp; i++) {
+        component_t *c = slow.comp[i];
+        c->i_now = c->i_next;
+    }
+    slow_start_t = model_t;
+    slow_active = true;
+}
+
+static void partition_add_node(partition_t * p, node_t * n)
+{
+    if (p->max_node == p->max_alloced_node) {
+        p->max_alloced_node = (p->max_alloced_node == 0 ? 100 : 2 * p->max_alloced_node);
+        p->node = realloc(p->node, p->max_alloced_node * sizeof(node_t*));
+        assert(p->node);
+    }
+    p->node[p->max_node++] = n;
+}
+
+static void partition_add_comp(partition_t * p, component_t * c)
+{
+    if (p->max_comp == p->max_alloced_comp) {
+        p->max_alloced_comp = (p->max_alloced_comp == 0 ? 100 : 2 * p->max_alloced_comp);
+        p->comp = realloc(p->comp, p->max_alloced_comp * sizeof(component_t*));
+        assert(p->comp);
+    }
+    p->comp[p->max_comp++] = c;
+}
+
+// -----------------  EVAL CIRCUIT  --------------------------------------------------
+
 static void eval_circuit_for_delta_t(void)
 {
-    uint64_t i, j, count=0;
+    int32_t i, count;
+    long double fraction;
+
+    // the power supply voltages do not change during the iterations of 
+    // eval_partition, so evaluate them once for this time step
+    if (perf_sample) {
+        perf_t = PERF_COUNTER();
+    }
+    eval_power_voltages();
+
+    // when a slow step is in progress the slow nodes' voltages are interpolated
+    // for the end of this step; the last step of a slow step may overshoot the 
+    // end of the slow step slightly, in which case the voltages are extrapolated
+    if (slow_active) {
+        fraction = (model_t + delta_t - slow_start_t) / slow_delta_t;
+        if (fraction >= 1 - 1e-9) {
+            slow_active = false;
+        }
+        for (i = 0; i < slow.max_node; i++) {
+            node_t * n = slow.node[i];
+            n->v_next = n->v_slow_start + (n->v_slow_end - n->v_slow_start) * fraction;
+            n->dv_dt = (n->v_next - n->v_now) / delta_t;
+        }
+    }
+
+    // evaluate the fast partition
+    count = eval_partition(&fast, delta_t);
+
+    // keep track of the number of iterations that were needed to stabilize
+    total_steps++;
+    total_iterations += count;
+    if (count > max_iterations) {
+        max_iterations = count;
+    }
+    iteration_hist[count >= (1 << (MAX_PERF_HIST-1)) ? MAX_PERF_HIST-1 : 63 - __builtin_clzll(count)]++;
 
-    // This routine will evaluate the circuit for a single time increment (delta_t).
+    // completed evaluating the circuit's progression for thise delta_t interval;
+    // move the 'next' values to 'now' values
+    for (i = 0; i < max_node; i++) {
+        node_t * n = &node[i];
+        n->v_now = n->v_next;
+    }
+    for (i = 0; i < max_component; i++) {
+        component_t *c = &component[i];
+        c->i_now = c->i_next;
+    }
+    PERF_PHASE_DONE(PERF_PHASE_COMMIT);
+
+    // compute component power dissipation (watts)
+    // - reverse the sign for power supply power, so it is positive too
+    // - use windowed_average routine which averages the 'watts' arg value,
+    //   weighted by time, over a 0.1 second interval
+    for (i = 0; i < max_component; i++) {
+        component_t *c = &component[i];
+        long double watts;
+
+        if (c->type != COMP_RESISTOR &&
+            c->type != COMP_CAPACITOR &&
+            c->type != COMP_INDUCTOR &&
+            c->type != COMP_DIODE &&
+            c->type != COMP_POWER)
+        {
+            continue;
+        }
+
+        watts = (c->term[0].node->v_now - c->term[1].node->v_now) * c->i_now;
+        if (c->type == COMP_POWER) {
+            watts = -watts;
+        }
+        windowed_average(watts, model_t, &c->watts);
+    }
+    PERF_PHASE_DONE(PERF_PHASE_WATTS);
+}
+
+static void eval_power_voltages(void)
+{
+    int32_t i;
+
+    for (i = 0; i < max_node; i++) {
+        node_t * n = & node[i];
+        if (n->power && !n->ground) {
+            n->v_next = get_comp_power_voltage(n->power->component);
+        }
+    }
+}
+
+static int32_t eval_partition(partition_t * p, long double dt)
+{
+    int32_t i, j, count=0;
+
+    // This routine will evaluate the partition's nodes and components for a 
+    // single time increment (dt); the nodes that are not in the partition
+    // are held at their v_next and dv_dt values.
     // 
     // The 'next' node voltage values, and 'next' node current values are calculated
     // for each node and component. And then circuit_is_stable is called to evaluate
@@ -622,13 +1348,13 @@ static void eval_circuit_for_delta_t(void)
         // BTW this is a nice description of capacitors and inductors.
         // https://ocw.mit.edu/courses/electrical-engineering-and-computer-science/6-071j-introduction-to-electronics-signals-and-measurement-spring-2006/lecture-notes/capactr_inductr.pdf
         //
-        for (i = 0; i < max_node; i++) {
-            node_t * n = & node[i];
+        for (i = 0; i < p->max_node; i++) {
+            node_t * n = p->node[i];
 
             if (n->ground) {
                 n->v_next = 0;
             } else if (n->power) {
-                n->v_next = get_comp_power_voltage(n->power->component);
+                // v_next was set above, prior to iterating
             } else {
                 long double sum_num=0, sum_denom=0;
 
@@ -644,18 +1370,18 @@ static void eval_circuit_for_delta_t(void)
                         sum_denom += (1 / c->resistor.ohms);
                         break;
                     case COMP_CAPACITOR:
-                        sum_num += (c->capacitor.farads / delta_t) * n->v_now +
+                        sum_num += (c->capacitor.farads / dt) * n->v_now +
                                    c->capacitor.farads * other_n->dv_dt;
-                        sum_denom += c->capacitor.farads / delta_t;
+                        sum_denom += c->capacitor.farads / dt;
                         break;
                     case COMP_INDUCTOR:
-                        sum_num += (delta_t / c->inductor.henrys) * other_n->v_next;
+                        sum_num += (dt / c->inductor.henrys) * other_n->v_next;
                         if (termid == 0) {
                             sum_num -= c->i_now;
                         } else {
                             sum_num += c->i_now;
                         }
-                        sum_denom += delta_t / c->inductor.henrys;
+                        sum_denom += dt / c->inductor.henrys;
                         break;
                     case COMP_DIODE: {
                         sum_num += (other_n->v_next / c->diode_ohms);
@@ -668,11 +1394,12 @@ static void eval_circuit_for_delta_t(void)
                 n->v_next = sum_num / sum_denom;
             }
         }
+        PERF_PHASE_DONE(PERF_PHASE_NODE_V);
 
         // compute the current through each component;
         // also, for COMP_DIODE, compute the equivalent resistance, c->diode_ohms
-        for (i = 0; i < max_component; i++) {
-            component_t *c = &component[i];
+        for (i = 0; i < p->max_comp; i++) {
+            component_t *c = p->comp[i];
             node_t *n0 = c->term[0].node;
             node_t *n1 = c->term[1].node;
             switch (c->type) {
@@ -681,11 +1408,11 @@ static void eval_circuit_for_delta_t(void)
                 break;
             case COMP_CAPACITOR:
                 c->i_next = ((n0->v_next - n1->v_next) - (n0->v_now - n1->v_now)) *
-                            (c->capacitor.farads / delta_t);
+                            (c->capacitor.farads / dt);
                 break;
             case COMP_INDUCTOR: {
                 long double dv = n0->v_next - n1->v_next;
-                c->i_next = c->i_now + (delta_t / c->inductor.henrys) * dv;
+                c->i_next = c->i_now + (dt / c->inductor.henrys) * dv;
                 break; }
             case COMP_DIODE: {
                 long double dv = n0->v_next - n1->v_next;
@@ -698,10 +1425,11 @@ static void eval_circuit_for_delta_t(void)
                 break; }
             }
         }
+        PERF_PHASE_DONE(PERF_PHASE_COMP_I);
 
         // compute the power supply component current
-        for (i = 0; i < max_node; i++) {
-            node_t * n = & node[i];
+        for (i = 0; i < p->max_node; i++) {
+            node_t * n = p->node[i];
             if (n->power == NULL) {
                 continue;
             }
@@ -718,58 +1446,40 @@ static void eval_circuit_for_delta_t(void)
             }
             n->power->component->i_next = -total_current;
         }
+        PERF_PHASE_DONE(PERF_PHASE_POWER_I);
 
         // compute dv_dt for all nodes
-        for (i = 0; i < max_node; i++) {
-            node_t * n = &node[i];
-            n->dv_dt = (n->v_next - n->v_now) / delta_t;
+        for (i = 0; i < p->max_node; i++) {
+            node_t * n = p->node[i];
+            n->dv_dt = (n->v_next - n->v_now) / dt;
         }
+        PERF_PHASE_DONE(PERF_PHASE_DV_DT);
 
         // check if the circuit is stable, meaning that for each node the sum of currents 
         // is close to zero; and if stable break out of the loop 
         count++;
-        if (circuit_is_stable(count)) {
+        if (circuit_is_stable(p, count)) {
+            PERF_PHASE_DONE(PERF_PHASE_STABLE);
             break;
         }
-    }
-
-    // completed evaluating the circuit's progression for thise delta_t interval;
-    // move the 'next' values to 'now' values
-    for (i = 0; i < max_node; i++) {
-        node_t * n = &node[i];
-        n->v_now = n->v_next;
-    }
-    for (i = 0; i < max_component; i++) {
-        component_t *c = &component[i];
-        c->i_now = c->i_next;
-    }
-
-    // compute component power dissipation (watts)
-    // - reverse the sign for power supply power, so it is positive too
-    // - use timed_moving_average routine which averages the 'watts' arg value
-    //   over a 1 second interval
-    for (i = 0; i < max_component; i++) {
-        component_t *c = &component[i];
-        long double watts;
-
-        if (c->type != COMP_RESISTOR &&
-            c->type != COMP_CAPACITOR &&
-            c->type != COMP_INDUCTOR &&
-            c->type != COMP_DIODE &&
-            c->type != COMP_POWER)
-        {
-            continue;
-        }
-
-        watts = (c->term[0].node->v_now - c->term[1].node->v_now) * c->i_now;
-        if (c->type == COMP_POWER) {
-            watts = -watts;
+        PERF_PHASE_DONE(PERF_PHASE_STABLE);
+
+        // when the intermediate param is on, the display is provided with
+        // the values computed by these iterations, before the evaluation 
+        // stabilizes; this is useful when evaluating the resistor grid, to 
+        // watch the progression prior to stabilizing
+        if (config.intermediate && __atomic_load_n(&snapshot_req, __ATOMIC_ACQUIRE)) {
+            publish_snapshot(true);
+            if (perf_sample) {
+                perf_t = PERF_COUNTER();
+            }
         }
-        timed_moving_average(watts, model_t, c->watts);
     }
+
+    return count;
 }
 
-static bool circuit_is_stable(int32_t count)
+static bool circuit_is_stable(partition_t * p, int32_t count)
 {
     #define MAX_COUNT 100000
 
@@ -779,8 +1489,8 @@ static bool circuit_is_stable(int32_t count)
     // loop over all nodes and for each node check that the sum of 
     // the currents is close to zero; if all nodes have currents sums
     // close to zero then the circuit is stable
-    for (i = 0; i < max_node; i++) {
-        node_t * n = &node[i];
+    for (i = 0; i < p->max_node; i++) {
+        node_t * n = p->node[i];
 
         // don't check the power and ground nodes
         if (n->power || n->ground) {
@@ -836,7 +1546,7 @@ static bool circuit_is_stable(int32_t count)
                 char s1[100];
                 DEBUG("failed to stabilize: count=%d gl=%s voltage=%Lf sum_i=%Lf "
                       "sum_abs_i=%.12Lf frac=%Lf max_frac=%Lf\n",
-                      count, gridloc_to_str(&n->gridloc[0],s1), n->v_next, sum_i, 
+                      count, gridloc_to_str(&n->term[0]->gridloc,s1), n->v_next, sum_i, 
                       sum_abs_i, fraction, max_fraction);
 #endif
                 failed_to_stabilize_count++;
@@ -854,9 +1564,8 @@ static long double get_comp_power_voltage(component_t * c)
 {
     long double v;
 
-    if (c->power.hz == 0) {
-        // dc 
-        if (strcasecmp(param_str_val(PARAM_DCPWR_RAMP), "on") == 0) {
+    if (c->power.wave_form == WAVE_FORM_DC) {
+        if (config.dcpwr_ramp) {
             if (model_t >= DCPWR_RAMP_T) {
                 v = c->power.volts;
             } else {
@@ -865,34 +1574,96 @@ static long double get_comp_power_voltage(component_t * c)
         } else {
             v = c->power.volts;
         }
-    } else if (c->power.wave_form == WAVE_FORM_SINE) {
-        v = c->power.volts * sinl(model_t * c->power.hz * (2. * M_PI));
-    } else if (c->power.wave_form == WAVE_FORM_SQUARE) {
-        long double cycles = model_t * c->power.hz;
-        cycles -= floor(cycles);
-#if 0
-        v = (cycles < 0.5 ? c->power.volts : -c->power.volts);
-#else
-        #define RISE_TIME .01
-        long double slope = 2 * c->power.volts / RISE_TIME;
-
-        if (cycles < RISE_TIME) {
-            v = -c->power.volts + slope * cycles;
-        } else if (cycles < 0.5) {
-            v = c->power.volts;
-        } else if (cycles < 0.5+RISE_TIME) {
-            v = c->power.volts - slope * (cycles - 0.5);
-        } else {
-            v = -c->power.volts;
-        }
-#endif
-    } else if (c->power.wave_form == WAVE_FORM_TRIANGLE) {
-        FATAL("triangle wave form not supported yet\n");
-        v = 0;
     } else {
-        assert(0);
+        v = waveform_eval(c, model_t);
     }
 
     return v;
 }
 
+static long double get_next_breakpoint(void)
+{
+    int32_t i;
+    long double bp, next_bp = INFINITY;
+
+    // return the earliest breakpoint, after model_t, of all power supplies;
+    // when dcpwr_ramp is enabled the end of the ramp is also a breakpoint
+    for (i = 0; i < max_component; i++) {
+        component_t * c = &component[i];
+        if (c->type != COMP_POWER) {
+            continue;
+        }
+        if (c->power.wave_form == WAVE_FORM_DC) {
+            bp = (config.dcpwr_ramp && model_t < DCPWR_RAMP_T) ? DCPWR_RAMP_T : INFINITY;
+        } else {
+            bp = waveform_next_breakpoint(c, model_t);
+        }
+        if (bp < next_bp) {
+            next_bp = bp;
+        }
+    }
+    return next_bp;
+}
+
+// -----------------  SNAPSHOT  ------------------------------------------------------
+
+// publish a snapshot of the circuit values, for the display; the snapshot 
+// is protected by a sequence lock, snapshot_seq is odd while the snapshot
+// is being updated; this is called by the model_thread, and by model_reset 
+// and model_run while the model_thread is idle
+//
+// the snapshot's arrays are grown when the number of nodes or components has 
+// increased, which only happens when this is called by model_reset or model_run;
+// the display lock is then held, so the display is not copying the snapshot
+static void publish_snapshot(bool intermediate)
+{
+    int32_t i;
+
+    pthread_mutex_lock(&snapshot_mutex);
+
+    if (max_node > snapshot.max_alloced_node) {
+        snapshot.v = realloc(snapshot.v, max_node * sizeof(snapshot.v[0]));
+        assert(snapshot.v);
+        snapshot.max_alloced_node = max_node;
+    }
+    if (max_component > snapshot.max_alloced_component) {
+        snapshot.i = realloc(snapshot.i, max_component * sizeof(snapshot.i[0]));
+        snapshot.watts = realloc(snapshot.watts, max_component * sizeof(snapshot.watts[0]));
+        assert(snapshot.i && snapshot.watts);
+        snapshot.max_alloced_component = max_component;
+    }
+
+    __atomic_store_n(&snapshot_seq, snapshot_seq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    snapshot.model_state               = model_state;
+    snapshot.model_t                   = model_t;
+    snapshot.delta_t                   = delta_t;
+    snapshot.stop_t                    = stop_t;
+    snapshot.failed_to_stabilize_count = failed_to_stabilize_count;
+    snapshot.total_steps               = total_steps;
+    snapshot.total_iterations          = total_iterations;
+    snapshot.max_iterations            = max_iterations;
+    snapshot.perf_total_ticks          = perf_total_ticks;
+    snapshot.perf_sampled_steps        = perf_sampled_steps;
+    snapshot.perf_ticks_per_sec        = perf_ticks_per_sec;
+    snapshot.max_slow_node             = slow.max_node;
+    snapshot.total_slow_steps          = total_slow_steps;
+    memcpy(snapshot.perf_ticks, perf_ticks, sizeof(perf_ticks));
+    memcpy(snapshot.iteration_hist, iteration_hist, sizeof(iteration_hist));
+    snapshot.max_node                  = max_node;
+    snapshot.max_component             = max_component;
+    for (i = 0; i < max_node; i++) {
+        snapshot.v[i] = (intermediate ? node[i].v_next : node[i].v_now);
+    }
+    for (i = 0; i < max_component; i++) {
+        snapshot.i[i] = (intermediate ? component[i].i_next : component[i].i_now);
+        snapshot.watts[i] = windowed_average_query(&component[i].watts);
+    }
+
+    __atomic_store_n(&snapshot_seq, snapshot_seq+1, __ATOMIC_RELEASE);
+    __atomic_store_n(&snapshot_req, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&update_count, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&snapshot_mutex);
+}
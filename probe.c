@@ -0,0 +1,375 @@
+/*
+Copyright (c) 2018 Steven Haid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "common.h"
+
+//
+// defines
+//
+
+//
+// typedefs
+//
+
+#define SLOT(b)  ((b) & (PROBE_MAX_BUCKET-1))
+
+//
+// variables
+//
+
+static long double base_t;
+static uint64_t    probe_seq;
+
+//
+// prototypes
+//
+
+static void probe_parse(int32_t idx, probe_t * p);
+static void clear_probe_history(probe_t * p);
+static bool record_bucket(probe_level_t * lvl, int64_t b, float v);
+
+// -----------------  PUBLIC  --------------------------------------------------------
+
+// called by model_run, prior to starting the model_thread, to clear 
+// the history of all probes and set the level 0 bucket time span
+void probe_reset_history(long double base_t_arg)
+{
+    int32_t i;
+
+    base_t = base_t_arg;
+    for (i = 0; i < MAX_SCOPE; i++) {
+        clear_probe_history(&probe[i]);
+    }
+}
+
+// resolve the scope params to the nodes or component to be recorded;
+// this is called by the model_thread when the scope params change, and 
+// when the model_state changes, because the nodes are created by model_run 
+// and are invalidated by model_reset
+void probe_resolve(void)
+{
+    int32_t i, j;
+    probe_t new_probe, *p;
+
+    // the probes are read by the display and cli threads using probe_get; 
+    // they are protected by a sequence lock, probe_seq is odd while the 
+    // probes are being updated
+    __atomic_store_n(&probe_seq, probe_seq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (i = 0; i < MAX_SCOPE; i++) {
+        p = &probe[i];
+
+        // parse the scope param and locate its nodes or component
+        memset(&new_probe, 0, sizeof(new_probe));
+        if (model_state != MODEL_STATE_RESET) {
+            probe_parse(i, &new_probe);
+        }
+
+        // if what is being recorded has changed then clear this probe's 
+        // history, so that the values recorded for a prior probe are 
+        // not displayed
+        if (new_probe.type != PROBE_NONE &&
+            (new_probe.type != p->type ||
+             new_probe.node0 != p->node0 ||
+             new_probe.node1 != p->node1 ||
+             new_probe.component != p->component ||
+             new_probe.sign != p->sign))
+        {
+            if (p->history == NULL) {
+                p->history = malloc(PROBE_MAX_LEVEL * PROBE_MAX_BUCKET * sizeof(hist_t));
+                assert(p->history);
+                for (j = 0; j < PROBE_MAX_LEVEL; j++) {
+                    p->level[j].bucket = p->history + j * PROBE_MAX_BUCKET;
+                }
+            }
+            clear_probe_history(p);
+        }
+
+        // update the probe, retaining the history
+        memcpy(new_probe.level, p->level, sizeof(p->level));
+        new_probe.history = p->history;
+        new_probe.history_gen = p->history_gen;
+        *p = new_probe;
+    }
+
+    __atomic_store_n(&probe_seq, probe_seq+1, __ATOMIC_RELEASE);
+}
+
+// copy probe idx, consistent with the most recent probe_resolve; the 
+// copy's history continues to be updated by probe_record
+void probe_get(int32_t idx, probe_t * p)
+{
+    uint64_t seq;
+
+    while (true) {
+        seq = __atomic_load_n(&probe_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(p, &probe[idx], sizeof(probe_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&probe_seq, __ATOMIC_RELAXED) == seq) {
+            break;
+        }
+    }
+}
+
+// record the value of each probe at time t, in each level of the pyramid
+void probe_record(long double t)
+{
+    int32_t i, j;
+    int64_t b;
+    probe_t *p;
+    float v;
+
+    if (base_t <= 0 || t < 0) {
+        return;
+    }
+    b = t / base_t;
+
+    for (i = 0; i < MAX_SCOPE; i++) {
+        p = &probe[i];
+        if (p->type == PROBE_NONE) {
+            continue;
+        }
+
+        v = (p->type == PROBE_VOLTAGE 
+             ? p->node0->v_next - p->node1->v_next
+             : p->sign * p->component->i_next);
+
+        // the higher levels' buckets contain this level's bucket, so if
+        // this level's bucket is not changed then neither are the higher levels
+        for (j = 0; j < PROBE_MAX_LEVEL; j++) {
+            if (!record_bucket(&p->level[j], b >> j, v)) {
+                break;
+            }
+        }
+    }
+}
+
+// return the min/max of the probe's values for each of the width intervals
+// in the time range t_start to t_start+t_span; the level used is the finest
+// level whose buckets are no longer than the interval, and that still 
+// retains the interval; intervals without values are returned as NAN
+void probe_get_history(probe_t * p, long double t_start, long double t_span, int32_t width, hist_t * out)
+{
+    int32_t x, l, first_level;
+    int64_t b, ba, bb, newest;
+    long double interval, ta, tb, bucket_t;
+    probe_level_t *lvl;
+    hist_t *h;
+
+    interval = t_span / width;
+    first_level = 0;
+    while (first_level < PROBE_MAX_LEVEL-1 && 
+           base_t * (1LL << (first_level+1)) <= interval)
+    {
+        first_level++;
+    }
+
+    for (x = 0; x < width; x++) {
+        out[x].min = out[x].max = NAN;
+
+        ta = t_start + x * interval;
+        tb = ta + interval;
+        if (p->history == NULL || base_t <= 0 || tb <= 0) {
+            continue;
+        }
+        if (ta < 0) {
+            ta = 0;
+        }
+
+        for (l = first_level; l < PROBE_MAX_LEVEL; l++) {
+            lvl = &p->level[l];
+            newest = __atomic_load_n(&lvl->newest, __ATOMIC_ACQUIRE);
+            bucket_t = base_t * (1LL << l);
+            ba = ta / bucket_t;
+            bb = ceill(tb / bucket_t) - 1;
+            if (bb < ba) {
+                bb = ba;
+            }
+
+            // if the interval is in the future then there are no values
+            if (ba > newest) {
+                break;
+            }
+
+            // if this level no longer retains the start of the interval 
+            // then try the next coarser level
+            if (ba <= newest - PROBE_MAX_BUCKET) {
+                continue;
+            }
+
+            // combine the buckets that overlap the interval
+            if (bb > newest) {
+                bb = newest;
+            }
+            for (b = ba; b <= bb; b++) {
+                h = &lvl->bucket[SLOT(b)];
+                if (isnan(h->min)) {
+                    continue;
+                }
+                if (isnan(out[x].min) || h->min < out[x].min) out[x].min = h->min;
+                if (isnan(out[x].max) || h->max > out[x].max) out[x].max = h->max;
+            }
+            break;
+        }
+    }
+}
+
+// return the time span of the probe's newest level 0 bucket; the values 
+// recorded prior to t_start are final, and no values have yet been recorded 
+// after t_end; returns -1 if the probe has no history
+int32_t probe_get_newest(probe_t * p, long double * t_start, long double * t_end)
+{
+    int64_t newest;
+
+    newest = __atomic_load_n(&p->level[0].newest, __ATOMIC_ACQUIRE);
+    if (p->history == NULL || base_t <= 0 || newest < 0) {
+        return -1;
+    }
+    *t_start = newest * base_t;
+    *t_end = (newest + 1) * base_t;
+    return 0;
+}
+
+// -----------------  PRIVATE  -------------------------------------------------------
+
+static void clear_probe_history(probe_t * p)
+{
+    int32_t i;
+
+    for (i = 0; i < PROBE_MAX_LEVEL; i++) {
+        __atomic_store_n(&p->level[i].newest, -1, __ATOMIC_RELEASE);
+    }
+    __atomic_add_fetch(&p->history_gen, 1, __ATOMIC_RELEASE);
+}
+
+// add v to the level's bucket b, and return true if the bucket changed;
+// when b is a new bucket, the ring slots of the buckets that are skipped 
+// are cleared
+static bool record_bucket(probe_level_t * lvl, int64_t b, float v)
+{
+    int64_t k, first;
+    hist_t *h;
+
+    if (b > lvl->newest) {
+        first = (lvl->newest < b - PROBE_MAX_BUCKET ? b - PROBE_MAX_BUCKET + 1 : lvl->newest + 1);
+        for (k = first; k < b; k++) {
+            h = &lvl->bucket[SLOT(k)];
+            h->min = h->max = NAN;
+        }
+        h = &lvl->bucket[SLOT(b)];
+        h->min = h->max = v;
+        __atomic_store_n(&lvl->newest, b, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    if (b <= lvl->newest - PROBE_MAX_BUCKET) {
+        return false;
+    }
+
+    h = &lvl->bucket[SLOT(b)];
+    if (v > h->max) {
+        h->max = v;
+    } else if (v < h->min) {
+        h->min = v;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// parse and verify the scope param, examples:
+// - off
+// - voltage,0v,5v,c3,c4,this-is-the-title
+// - current,-100ma,100ma,c3,c4,this-is-the-title
+// if the scope param is off or invalid, or the nodes don't exist, then 
+// p->type is left set to PROBE_NONE
+static void probe_parse(int32_t idx, probe_t * p)
+{
+    char s[100], *select_str, *ymin_str, *ymax_str, *gl0_str, *gl1_str, *title_str;
+    grid_t *g0, *g1;
+    component_t *c;
+    int32_t j;
+
+    strcpy(s, param_str_val(PARAM_SCOPE_A+idx));
+    select_str = strtok(s, ",");
+    ymin_str = strtok(NULL, ",");
+    ymax_str = strtok(NULL, ",");
+    gl0_str = strtok(NULL, ",");
+    gl1_str = strtok(NULL, ",");
+    title_str = strtok(NULL, "");
+    if (title_str == NULL) {
+        return;
+    }
+    if (strcasecmp(select_str,"voltage") != 0 && 
+        strcasecmp(select_str,"current") != 0) 
+    {
+        return;
+    }
+    p->units = (strcasecmp(select_str,"voltage") == 0) ? UNITS_VOLTS : UNITS_AMPS;
+    if ((str_to_val(ymin_str, p->units, &p->ymin) < 0) ||
+        (str_to_val(ymax_str, p->units, &p->ymax) < 0) ||
+        (str_to_gridloc(gl0_str, &p->gl0) < 0) ||
+        (str_to_gridloc(gl1_str, &p->gl1) < 0))
+    {
+        return;
+    }
+    g0 = grid_get(&p->gl0);
+    g1 = grid_get(&p->gl1);
+    if (g0 == NULL || g1 == NULL || g0->node == NULL || g1->node == NULL) {
+        return;
+    }
+    strncpy(p->title, title_str, sizeof(p->title)-1);
+
+    if (p->units == UNITS_VOLTS) {
+        p->node0 = g0->node;
+        p->node1 = g1->node;
+        p->sign = 1;
+        p->type = PROBE_VOLTAGE;
+    } else {
+        // search for the component between gl0 and gl1
+        for (j = 0; j < g0->max_term; j++) {
+            c = g0->term[j]->component;
+            if (c->type == COMP_NONE || c->type == COMP_WIRE) {
+                continue;
+            }
+            if (memcmp(&c->term[0].gridloc, &p->gl0, sizeof(gridloc_t)) == 0 && 
+                memcmp(&c->term[1].gridloc, &p->gl1, sizeof(gridloc_t)) == 0) 
+            {
+                p->component = c;
+                p->sign = 1;
+                p->type = PROBE_CURRENT;
+                break;
+            } else if (memcmp(&c->term[0].gridloc, &p->gl1, sizeof(gridloc_t)) == 0 && 
+                       memcmp(&c->term[1].gridloc, &p->gl0, sizeof(gridloc_t)) == 0) 
+            {
+                p->component = c;
+                p->sign = -1;
+                p->type = PROBE_CURRENT;
+                break;
+            }
+        }
+    }
+}
@@ -531,3 +531,91 @@ void timed_moving_average_reset(tma_t * tma)
     moving_average_reset(tma->ma);
 }
 
+// - - - - - - - - - - - - - - - - - - - - 
+
+// the window is divided into WA_MAX_BLOCK blocks, each block holds the integral
+// of val over time within that block; the average is the sum of the block 
+// integrals divided by the sum of the block times, so the window slides in 
+// increments of time_span/WA_MAX_BLOCK
+long double windowed_average(long double val, long double time_arg, wa_t *wa)
+{
+    int64_t idx, i;
+    long double dt;
+
+    // time can't go backwards, if it does then start over
+    if (!wa->first_call && time_arg < wa->last_time) {
+        windowed_average_reset(wa);
+    }
+
+    // on the first call there is no time interval to integrate over, 
+    // so the current value is just val
+    if (wa->first_call) {
+        wa->first_call = false;
+        wa->block_idx  = time_arg / wa->block_span;
+        wa->last_time  = time_arg;
+        wa->current    = val;
+        return wa->current;
+    }
+
+    // advance to the block that contains time_arg, discarding the 
+    // blocks that have moved out of the window; the totals are recomputed 
+    // from the blocks, rather than subtracted, so that rounding errors
+    // don't accumulate
+    idx = time_arg / wa->block_span;
+    if (idx != wa->block_idx) {
+        if (idx - wa->block_idx >= WA_MAX_BLOCK) {
+            memset(wa->block_sum, 0, sizeof(wa->block_sum));
+            memset(wa->block_time, 0, sizeof(wa->block_time));
+        } else {
+            for (i = wa->block_idx + 1; i <= idx; i++) {
+                wa->block_sum[i % WA_MAX_BLOCK]  = 0;
+                wa->block_time[i % WA_MAX_BLOCK] = 0;
+            }
+        }
+        wa->sum  = 0;
+        wa->time = 0;
+        for (i = 0; i < WA_MAX_BLOCK; i++) {
+            wa->sum  += wa->block_sum[i];
+            wa->time += wa->block_time[i];
+        }
+        wa->block_idx = idx;
+    }
+
+    // add the integral of val over the interval since the last call
+    dt = time_arg - wa->last_time;
+    wa->block_sum[idx % WA_MAX_BLOCK]  += val * dt;
+    wa->block_time[idx % WA_MAX_BLOCK] += dt;
+    wa->sum  += val * dt;
+    wa->time += dt;
+    wa->last_time = time_arg;
+
+    wa->current = (wa->time > 0 ? wa->sum / wa->time : val);
+    return wa->current;
+}
+
+long double windowed_average_query(wa_t *wa)
+{
+    return wa->current;
+}
+
+void windowed_average_init(wa_t * wa, long double time_span)
+{
+    wa->time_span  = time_span;
+    wa->block_span = time_span / WA_MAX_BLOCK;
+
+    windowed_average_reset(wa);
+}
+
+void windowed_average_reset(wa_t * wa)
+{
+    wa->first_call = true;
+    wa->block_idx  = 0;
+    wa->last_time  = 0;
+    wa->sum        = 0;
+    wa->time       = 0;
+    wa->current    = NAN;
+
+    memset(wa->block_sum, 0, sizeof(wa->block_sum));
+    memset(wa->block_time, 0, sizeof(wa->block_time));
+}
+
@@ -152,4 +152,26 @@ tma_t * timed_moving_average_alloc(long double time_span, int64_t max_bins);
 void timed_moving_average_free(tma_t * tma);
 void timed_moving_average_reset(tma_t * tma);
 
+// - - - - - - - - - - - - - - - - - - - - 
+
+// windowed average: a time weighted average over the most recent time_span, 
+// using a small fixed number of block sums so that the memory is constant
+#define WA_MAX_BLOCK 16
+typedef struct {
+    long double time_span;
+    long double block_span;
+    bool first_call;
+    int64_t block_idx;
+    long double last_time;
+    long double sum;
+    long double time;
+    long double block_sum[WA_MAX_BLOCK];
+    long double block_time[WA_MAX_BLOCK];
+    long double current;
+} wa_t;
+long double windowed_average(long double val, long double time_arg, wa_t *wa);
+long double windowed_average_query(wa_t *wa);
+void windowed_average_init(wa_t * wa, long double time_span);
+void windowed_average_reset(wa_t * wa);
+
 #endif
@@ -38,6 +38,8 @@ SOFTWARE.
 #include <time.h>
 #include <limits.h>
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
 
 #include <sys/stat.h>
 
@@ -58,6 +60,15 @@ SOFTWARE.
 #define MAX_FONT_PTSIZE   200
 #define MAX_EVENT_REG_TBL 1000
 
+// print screen encoder threads, see sdl_print_screen
+#define MAX_ENCODER_THREAD      2
+#define MAX_ENCODER_JOB         8
+
+// text texture cache, see sdl_render_text
+#define MAX_TEXT_CACHE          1024
+#define MAX_TEXT_CACHE_HASH     2048   // must be power of 2
+#define MAX_TEXT_CACHE_STR      64
+
 #define min(a,b) \
    ({ __typeof__ (a) _a = (a); \
        __typeof__ (b) _b = (b); \
@@ -80,11 +91,33 @@ typedef struct {
     rect_t disp_loc;
 } sdl_event_reg_t;
 
+typedef struct {
+    char      file_name[PATH_MAX];
+    uint8_t * pixels;
+    int32_t   w;
+    int32_t   h;
+} sdl_encoder_job_t;
+
+typedef struct {
+    char        str[MAX_TEXT_CACHE_STR];
+    int32_t     font_ptsize;
+    int32_t     fg_color;
+    int32_t     bg_color;
+    uint32_t    hash;
+    texture_t   texture;
+    int32_t     width;
+    int32_t     height;
+    int32_t     hash_next;   // next entry in hash chain, -1 if none
+    int32_t     lru_prev;    // lru list, most recently used at lru_head
+    int32_t     lru_next;
+} sdl_text_cache_t;
+
 //
 // variables
 //
 
 static SDL_Window     * sdl_window;
+static SDL_Surface    * sdl_offscreen_surface;
 static SDL_Renderer   * sdl_renderer;
 static SDL_RendererInfo sdl_renderer_info;
 static int32_t          sdl_win_width;
@@ -97,6 +130,20 @@ static Mix_Chunk      * sdl_button_sound;
 static sdl_font_t       sdl_font[MAX_FONT_PTSIZE];
 static char           * sdl_font_path;
 
+static sdl_text_cache_t sdl_text_cache[MAX_TEXT_CACHE];
+static int32_t          sdl_text_cache_hash[MAX_TEXT_CACHE_HASH];
+static int32_t          sdl_text_cache_max;
+static int32_t          sdl_text_cache_lru_head = -1;
+static int32_t          sdl_text_cache_lru_tail = -1;
+
+static sdl_encoder_job_t sdl_encoder_job[MAX_ENCODER_JOB];
+static int32_t           sdl_encoder_job_head;   // next job to be encoded
+static int32_t           sdl_encoder_job_tail;   // next job slot to be filled
+static int32_t           sdl_encoder_busy;       // number of jobs being encoded
+static bool              sdl_encoder_started;
+static pthread_mutex_t   sdl_encoder_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    sdl_encoder_cond  = PTHREAD_COND_INITIALIZER;
+
 static sdl_event_reg_t  sdl_event_reg_tbl[MAX_EVENT_REG_TBL];
 static int32_t          sdl_event_max;
 static sdl_event_t      sdl_push_ev;
@@ -123,9 +170,12 @@ static uint32_t         sdl_color_to_rgba[] = {
 static void sdl_exit_handler(void);
 static void sdl_set_color(int32_t color); 
 static void sdl_font_init(int32_t ptsize);
+static sdl_text_cache_t * sdl_text_cache_get(int32_t font_ptsize, char * str, int32_t fg_color, int32_t bg_color);
 static void sdl_pane_terminate(struct pane_list_head_s * pane_list_head, pane_cx_t * pane_cx);
 static int32_t sdl_pane_move_speed(void);
 static char * sdl_print_screen_filename(void);
+static void * sdl_encoder_thread(void * cx);
+static void sdl_encoder_wait_idle(void);
 
 // 
 // inline procedures
@@ -142,7 +192,7 @@ static inline uint32_t _bswap32(uint32_t a)
 
 // -----------------  SDL INIT & MISC ROUTINES  ------------------------- 
 
-int32_t sdl_init(int32_t *w, int32_t *h, bool resizeable)
+int32_t sdl_init(int32_t *w, int32_t *h, bool resizeable, bool offscreen)
 {
     #define SDL_FLAGS (resizeable ? SDL_WINDOW_RESIZABLE : 0)
     #define MAX_FONT_SEARCH_PATH 3
@@ -159,30 +209,57 @@ int32_t sdl_init(int32_t *w, int32_t *h, bool resizeable)
         DEBUG("   %s\n",  SDL_GetVideoDriver(i));
     }
 
-    // initialize Simple DirectMedia Layer  (SDL)
-    if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO) < 0) {
-        ERROR("SDL_Init failed\n");
-        return -1;
-    }
+    // if offscreen then the display server, and the video and audio subsystems, 
+    // are not used; the events subsystem is still needed for the pane manager
+    if (offscreen) {
+        // initialize Simple DirectMedia Layer (SDL) events 
+        if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+            ERROR("SDL_Init failed\n");
+            return -1;
+        }
 
-    // create SDL Window and Renderer
-    if (SDL_CreateWindowAndRenderer(*w, *h, SDL_FLAGS, &sdl_window, &sdl_renderer) != 0) {
-        ERROR("SDL_CreateWindowAndRenderer failed\n");
-        return -1;
-    }
+        // create the surface that is rendered to, and its software renderer
+        sdl_offscreen_surface = SDL_CreateRGBSurfaceWithFormat(0, *w, *h, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (sdl_offscreen_surface == NULL) {
+            ERROR("SDL_CreateRGBSurfaceWithFormat failed, %s\n", SDL_GetError());
+            return -1;
+        }
+        sdl_renderer = SDL_CreateSoftwareRenderer(sdl_offscreen_surface);
+        if (sdl_renderer == NULL) {
+            ERROR("SDL_CreateSoftwareRenderer failed, %s\n", SDL_GetError());
+            return -1;
+        }
+        sdl_win_width = *w;
+        sdl_win_height = *h;
+        DEBUG("offscreen sdl_win_width=%d sdl_win_height=%d\n", sdl_win_width, sdl_win_height);
+    } else {
+        // initialize Simple DirectMedia Layer  (SDL)
+        if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO) < 0) {
+            ERROR("SDL_Init failed\n");
+            return -1;
+        }
+
+        // create SDL Window and Renderer
+        if (SDL_CreateWindowAndRenderer(*w, *h, SDL_FLAGS, &sdl_window, &sdl_renderer) != 0) {
+            ERROR("SDL_CreateWindowAndRenderer failed\n");
+            return -1;
+        }
 
-    // the size of the created window may be different than what was requested
-    // - call sdl_poll_event to flush all of the initial events,
-    //   and especially to process the SDL_WINDOWEVENT_SIZE_CHANGED event
-    //   which will update sdl_win_width and sdl_win_height
-    // - return the updated window width & height to caller
-    sdl_poll_event();
-    DEBUG("sdl_win_width=%d sdl_win_height=%d\n", sdl_win_width, sdl_win_height);
-    *w = sdl_win_width;
-    *h = sdl_win_height;
+        // the size of the created window may be different than what was requested
+        // - call sdl_poll_event to flush all of the initial events,
+        //   and especially to process the SDL_WINDOWEVENT_SIZE_CHANGED event
+        //   which will update sdl_win_width and sdl_win_height
+        // - return the updated window width & height to caller
+        sdl_poll_event();
+        DEBUG("sdl_win_width=%d sdl_win_height=%d\n", sdl_win_width, sdl_win_height);
+        *w = sdl_win_width;
+        *h = sdl_win_height;
+    }
 
     // init button_sound
-    if (Mix_OpenAudio( 22050, MIX_DEFAULT_FORMAT, 2, 4096) < 0) {
+    if (offscreen) {
+        DEBUG("offscreen, button sound not used\n");
+    } else if (Mix_OpenAudio( 22050, MIX_DEFAULT_FORMAT, 2, 4096) < 0) {
         WARN("Mix_OpenAudio failed\n");
     } else {
         sdl_button_sound = Mix_QuickLoad_WAV(button_sound_wav);
@@ -199,6 +276,11 @@ int32_t sdl_init(int32_t *w, int32_t *h, bool resizeable)
         return -1;
     }
 
+    // initialize the text texture cache hash table to empty
+    for (i = 0; i < MAX_TEXT_CACHE_HASH; i++) {
+        sdl_text_cache_hash[i] = -1;
+    }
+
     // determine sdl_font_path by searching for FreeMonoBold.ttf font file in possible locations
     // note - fonts can be installed using:
     //   sudo yum install gnu-free-mono-fonts       # rhel,centos,fedora
@@ -220,7 +302,9 @@ int32_t sdl_init(int32_t *w, int32_t *h, bool resizeable)
     DEBUG("using font %s\n", sdl_font_path);
 
     // currently the SDL Text Input feature is not being used here
-    SDL_StopTextInput();
+    if (!offscreen) {
+        SDL_StopTextInput();
+    }
 
     // register exit handler
     atexit(sdl_exit_handler);
@@ -233,12 +317,19 @@ int32_t sdl_init(int32_t *w, int32_t *h, bool resizeable)
 static void sdl_exit_handler(void)
 {
     int32_t i;
+
+    // wait for the print screen files to be written
+    sdl_encoder_wait_idle();
     
     if (sdl_button_sound) {
         Mix_FreeChunk(sdl_button_sound);
         Mix_CloseAudio();
     }
 
+    for (i = 0; i < sdl_text_cache_max; i++) {
+        sdl_destroy_texture(sdl_text_cache[i].texture);
+    }
+
     for (i = 0; i < MAX_FONT_PTSIZE; i++) {
         if (sdl_font[i].font != NULL) {
             TTF_CloseFont(sdl_font[i].font);
@@ -247,7 +338,12 @@ static void sdl_exit_handler(void)
     TTF_Quit();
 
     SDL_DestroyRenderer(sdl_renderer);
-    SDL_DestroyWindow(sdl_window);
+    if (sdl_window) {
+        SDL_DestroyWindow(sdl_window);
+    }
+    if (sdl_offscreen_surface) {
+        SDL_FreeSurface(sdl_offscreen_surface);
+    }
     SDL_Quit();
 }
 
@@ -303,13 +399,22 @@ static void sdl_font_init(int32_t font_ptsize)
 
 // -----------------  PANE MANAGER  ------------------------------------- 
 
+// the display is redrawn when an event requests it, and when redraw_interval_us has 
+// elapsed; in the latter case, if the redraw_needed callback is supplied then the
+// display is only redrawn if redraw_needed returns true or if an event has been 
+// passed to a pane handler, otherwise the check is repeated after another interval;
+// the interval is lengthened when rendering is slow, so that rendering uses no more
+// than 1/MAX_FRAME_DUTY_CYCLE of the time
 void sdl_pane_manager(void *display_cx,                        // optional, context
                       void (*display_start)(void *display_cx), // optional, called prior to pane handlers
                       void (*display_end)(void *display_cx),   // optional, called after pane handlers
+                      bool (*redraw_needed)(void *display_cx), // optional, returns true if display changed
                       int64_t redraw_interval_us,              // 0=continuous, -1=never, else us
                       int32_t count,                           // number of pane handler varargs that follow
                       ...)                                     // pane_handler, init_params, x_disp, y_disp, w, h, border_style
 {
+    #define MAX_FRAME_DUTY_CYCLE  10
+    #define MAX_EVENT_WAIT_US     100000
     #define FG_PANE_CX (TAILQ_LAST(&pane_list_head,pane_list_head_s))
 
     #define SDL_EVENT_PANE_SELECT            0xffffff01
@@ -319,8 +424,9 @@ void sdl_pane_manager(void *display_cx,                        // optional, cont
     va_list ap; 
     pane_cx_t *pane_cx, *pane_cx_next;
     int32_t ret, i, win_width, win_height;
-    bool redraw;
-    uint64_t start_us;
+    bool redraw, event_handled;
+    uint64_t start_us, now_us, wait_us;
+    int64_t interval_us;
     sdl_event_t * event;
     struct pane_list_head_s pane_list_head;
     rect_t loc_full_pane, loc_bar_move, loc_bar_terminate;
@@ -401,6 +507,14 @@ void sdl_pane_manager(void *display_cx,                        // optional, cont
         // present the display
         sdl_display_present();
 
+        // determine the interval until the display is next redrawn, this is 
+        // lengthened if rendering the display took a significant time
+        interval_us = redraw_interval_us;
+        if (interval_us > 0 && (microsec_timer() - start_us) * MAX_FRAME_DUTY_CYCLE > interval_us) {
+            interval_us = (microsec_timer() - start_us) * MAX_FRAME_DUTY_CYCLE;
+        }
+        event_handled = false;
+
         // handle events
         while (true) {
             call_pane_handler = false;
@@ -434,7 +548,8 @@ void sdl_pane_manager(void *display_cx,                        // optional, cont
                         call_pane_handler = true;
                     }
                 } else if (event->event_id == SDL_EVENT_WIN_SIZE_CHANGE ||  
-                           event->event_id == SDL_EVENT_WIN_RESTORED) 
+                           event->event_id == SDL_EVENT_WIN_RESTORED ||
+                           event->event_id == SDL_EVENT_WIN_EXPOSED) 
                 {
                     redraw = true;
                 } else if (event->event_id == SDL_EVENT_QUIT) {
@@ -470,16 +585,34 @@ void sdl_pane_manager(void *display_cx,                        // optional, cont
                 } else if (ret == PANE_HANDLER_RET_DISPLAY_REDRAW) {
                     redraw = true;
                 }
+                event_handled = true;
             }
 
-            if ((redraw) || 
-                (redraw_interval_us != -1 && microsec_timer() >= start_us + redraw_interval_us) ||
-                (sdl_program_quit))
-            {
+            if (redraw || sdl_program_quit) {
                 break;
             }
 
-            usleep(1000);
+            // if the redraw interval has elapsed then redraw, unless redraw_needed 
+            // indicates there is no change to display; in which case check
+            // again after another interval
+            now_us = microsec_timer();
+            if (interval_us != -1 && now_us >= start_us + interval_us) {
+                if (redraw_needed == NULL || event_handled || redraw_needed(display_cx)) {
+                    break;
+                }
+                start_us = now_us;
+            }
+
+            // if there was an event then check for another, otherwise wait for
+            // an event or until the redraw interval elapses
+            if (event->event_id != SDL_EVENT_NONE) {
+                continue;
+            }
+            wait_us = (interval_us == -1 ? MAX_EVENT_WAIT_US : start_us + interval_us - now_us);
+            if (wait_us > MAX_EVENT_WAIT_US) wait_us = MAX_EVENT_WAIT_US;
+            if (wait_us >= 1000) {
+                SDL_WaitEventTimeout(NULL, wait_us / 1000);
+            }
         }
     }
 
@@ -668,6 +801,10 @@ void sdl_display_init(int32_t * win_width, int32_t * win_height, bool * win_mini
 
 void sdl_display_present(void)
 {
+    // when offscreen the rendered display remains in the surface
+    if (sdl_offscreen_surface) {
+        return;
+    }
     SDL_RenderPresent(sdl_renderer);
 }
 
@@ -1048,6 +1185,9 @@ sdl_event_t * sdl_poll_event(void)
                 sdl_win_minimized = false;
                 event.event_id = SDL_EVENT_WIN_RESTORED;
                 break;
+            case SDL_WINDOWEVENT_EXPOSED:
+                event.event_id = SDL_EVENT_WIN_EXPOSED;
+                break;
             }
             break; }
 
@@ -1089,20 +1229,32 @@ void sdl_play_event_sound(void)
 
 // -----------------  RENDER TEXT  -------------------------------------- 
 
+// the text textures are cached, and reused when the same text is rendered again
+// with the same font size and colors; so that displays that are redrawn with mostly
+// the same text do not need to create a new texture for each call
 rect_t sdl_render_text(rect_t * pane, int32_t x, int32_t y, int32_t font_ptsize, char * str, 
                        int32_t fg_color, int32_t bg_color)
 {
-    texture_t texture;
-    int32_t   width, height;
-    rect_t    loc, loc_clipped = {0,0,0,0};
+    texture_t          texture;
+    int32_t            width, height;
+    rect_t             loc, loc_clipped = {0,0,0,0};
+    sdl_text_cache_t * tc;
     
-    // create the text texture
-    texture =  sdl_create_text_texture(fg_color, bg_color, font_ptsize, str);
-    if (texture == NULL) {
-        ERROR("sdl_create_text_texture failed\n");
-        return loc_clipped;
+    // get the text texture from the cache; or, if the text is too long to
+    // be cached, then create the text texture
+    tc = sdl_text_cache_get(font_ptsize, str, fg_color, bg_color);
+    if (tc != NULL) {
+        texture = tc->texture;
+        width   = tc->width;
+        height  = tc->height;
+    } else {
+        texture =  sdl_create_text_texture(fg_color, bg_color, font_ptsize, str);
+        if (texture == NULL) {
+            ERROR("sdl_create_text_texture failed\n");
+            return loc_clipped;
+        }
+        sdl_query_texture(texture, &width, &height);
     }
-    sdl_query_texture(texture, &width, &height);
 
     // determine the location within the pane that this
     // texture is to be rendered, if x or y is negative then
@@ -1124,12 +1276,118 @@ rect_t sdl_render_text(rect_t * pane, int32_t x, int32_t y, int32_t font_ptsize,
     loc_clipped = sdl_render_scaled_texture(pane, &loc, texture);
 
     // clean up
-    sdl_destroy_texture(texture);
+    if (tc == NULL) {
+        sdl_destroy_texture(texture);
+    }
 
     // return the location of the text (possibly clipped), within the pane
     return loc_clipped;
 }
 
+// return the text cache entry for the str, font size and colors, creating the
+// text texture if it is not in the cache; when the cache is full the least 
+// recently used entry is replaced; returns NULL if the str is too long to be 
+// cached, or if the texture could not be created
+static sdl_text_cache_t * sdl_text_cache_get(int32_t font_ptsize, char * str, int32_t fg_color, int32_t bg_color)
+{
+    uint32_t           hash;
+    int32_t            idx, len, *pidx;
+    sdl_text_cache_t * tc;
+    texture_t          texture;
+
+    // compute hash of the str, font size and colors (FNV-1a)
+    hash = 2166136261u;
+    for (len = 0; str[len] != '\0'; len++) {
+        hash = (hash ^ (uint8_t)str[len]) * 16777619u;
+    }
+    if (len >= MAX_TEXT_CACHE_STR) {
+        return NULL;
+    }
+    hash = (hash ^ font_ptsize) * 16777619u;
+    hash = (hash ^ (fg_color << 8 | bg_color)) * 16777619u;
+
+    // search the hash chain, and if found then move the entry to the 
+    // head of the lru list and return it
+    for (idx = sdl_text_cache_hash[hash & (MAX_TEXT_CACHE_HASH-1)]; idx != -1; idx = tc->hash_next) {
+        tc = &sdl_text_cache[idx];
+        if (tc->hash == hash &&
+            tc->font_ptsize == font_ptsize &&
+            tc->fg_color == fg_color &&
+            tc->bg_color == bg_color &&
+            strcmp(tc->str, str) == 0)
+        {
+            break;
+        }
+    }
+    if (idx != -1) {
+        if (idx != sdl_text_cache_lru_head) {
+            // unlink
+            sdl_text_cache[tc->lru_prev].lru_next = tc->lru_next;
+            if (tc->lru_next != -1) {
+                sdl_text_cache[tc->lru_next].lru_prev = tc->lru_prev;
+            } else {
+                sdl_text_cache_lru_tail = tc->lru_prev;
+            }
+            // insert at head
+            tc->lru_prev = -1;
+            tc->lru_next = sdl_text_cache_lru_head;
+            sdl_text_cache[sdl_text_cache_lru_head].lru_prev = idx;
+            sdl_text_cache_lru_head = idx;
+        }
+        return tc;
+    }
+
+    // not found, create the text texture
+    texture = sdl_create_text_texture(fg_color, bg_color, font_ptsize, str);
+    if (texture == NULL) {
+        return NULL;
+    }
+
+    // allocate a cache entry; if the cache is full then the least recently
+    // used entry is removed from its hash chain and the lru list, and reused
+    if (sdl_text_cache_max < MAX_TEXT_CACHE) {
+        idx = sdl_text_cache_max++;
+        tc = &sdl_text_cache[idx];
+    } else {
+        idx = sdl_text_cache_lru_tail;
+        tc = &sdl_text_cache[idx];
+        for (pidx = &sdl_text_cache_hash[tc->hash & (MAX_TEXT_CACHE_HASH-1)]; 
+             *pidx != idx; 
+             pidx = &sdl_text_cache[*pidx].hash_next) 
+        {
+            assert(*pidx != -1);
+        }
+        *pidx = tc->hash_next;
+        sdl_text_cache_lru_tail = tc->lru_prev;
+        sdl_text_cache[sdl_text_cache_lru_tail].lru_next = -1;
+        sdl_destroy_texture(tc->texture);
+    }
+
+    // init the cache entry, and add it to its hash chain and to the
+    // head of the lru list
+    strcpy(tc->str, str);
+    tc->font_ptsize = font_ptsize;
+    tc->fg_color    = fg_color;
+    tc->bg_color    = bg_color;
+    tc->hash        = hash;
+    tc->texture     = texture;
+    sdl_query_texture(texture, &tc->width, &tc->height);
+
+    tc->hash_next = sdl_text_cache_hash[hash & (MAX_TEXT_CACHE_HASH-1)];
+    sdl_text_cache_hash[hash & (MAX_TEXT_CACHE_HASH-1)] = idx;
+
+    tc->lru_prev = -1;
+    tc->lru_next = sdl_text_cache_lru_head;
+    if (sdl_text_cache_lru_head != -1) {
+        sdl_text_cache[sdl_text_cache_lru_head].lru_prev = idx;
+    } else {
+        sdl_text_cache_lru_tail = idx;
+    }
+    sdl_text_cache_lru_head = idx;
+
+    return tc;
+}
+
 // XXX what is str len is zero
 void sdl_render_printf(rect_t * pane, int32_t x, int32_t y, int32_t font_ptsize,
                        int32_t fg_color, int32_t bg_color, char * fmt, ...) 
@@ -1232,6 +1490,103 @@ void sdl_render_lines(rect_t * pane, point_t * points, int32_t count, int32_t co
     }
 }
 
+// render count/2 unconnected line segments, from points[0] to points[1], points[2] to
+// points[3], and so on; segments with an end point outside of the pane are not drawn;
+// the segments are drawn with a single SDL_RenderGeometry call, as 1 pixel wide quads,
+// when supported; otherwise with SDL_RenderDrawLine
+void sdl_render_line_segments(rect_t * pane, point_t * points, int32_t count, int32_t color)
+{
+    int32_t i;
+    point_t *p;
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+    static SDL_Vertex * vertices;
+    static int        * indices;
+    static int32_t      max_alloced;
+    int32_t             max_vertices=0, max_indices=0;
+    uint32_t            rgba;
+    SDL_Color           sdl_color;
+    float               x1, y1, x2, y2, len, ex, ey, ox, oy;
+
+    // allocate the vertex and index arrays, 4 vertices and 6 indices per segment
+    if (count/2 > max_alloced) {
+        max_alloced = count/2 + 1000;
+        vertices = realloc(vertices, max_alloced * 4 * sizeof(SDL_Vertex));
+        indices  = realloc(indices, max_alloced * 6 * sizeof(int));
+        assert(vertices && indices);
+    }
+
+    rgba = sdl_color_to_rgba[color];
+    sdl_color.r = (rgba >> 24) & 0xff;
+    sdl_color.g = (rgba >> 16) & 0xff;
+    sdl_color.b = (rgba >>  8) & 0xff;
+    sdl_color.a = (rgba      ) & 0xff;
+
+    // each segment is a quad centered on the pixels of the segment, extended by 
+    // half a pixel on each side and at each end
+    for (i = 0; i+1 < count; i += 2) {
+        p = &points[i];
+        if (p[0].x < 0 || p[0].x >= pane->w || p[0].y < 0 || p[0].y >= pane->h ||
+            p[1].x < 0 || p[1].x >= pane->w || p[1].y < 0 || p[1].y >= pane->h)
+        {
+            continue;
+        }
+
+        x1 = p[0].x + pane->x + 0.5;
+        y1 = p[0].y + pane->y + 0.5;
+        x2 = p[1].x + pane->x + 0.5;
+        y2 = p[1].y + pane->y + 0.5;
+        len = hypotf(x2-x1, y2-y1);
+        if (len == 0) {
+            ex = 0.5; ey = 0;
+        } else {
+            ex = (x2-x1) / len * 0.5;
+            ey = (y2-y1) / len * 0.5;
+        }
+        ox = -ey;
+        oy = ex;
+
+        SDL_Vertex * v = &vertices[max_vertices];
+        v[0].position.x = x1 - ex + ox;  v[0].position.y = y1 - ey + oy;
+        v[1].position.x = x1 - ex - ox;  v[1].position.y = y1 - ey - oy;
+        v[2].position.x = x2 + ex - ox;  v[2].position.y = y2 + ey - oy;
+        v[3].position.x = x2 + ex + ox;  v[3].position.y = y2 + ey + oy;
+        v[0].color = v[1].color = v[2].color = v[3].color = sdl_color;
+
+        indices[max_indices++] = max_vertices + 0;
+        indices[max_indices++] = max_vertices + 1;
+        indices[max_indices++] = max_vertices + 2;
+        indices[max_indices++] = max_vertices + 0;
+        indices[max_indices++] = max_vertices + 2;
+        indices[max_indices++] = max_vertices + 3;
+        max_vertices += 4;
+    }
+
+    if (max_vertices == 0) {
+        return;
+    }
+    if (SDL_RenderGeometry(sdl_renderer, NULL, vertices, max_vertices, indices, max_indices) == 0) {
+        return;
+    }
+
+    // SDL_RenderGeometry failed, fall through to draw the segments as lines
+#endif
+
+    sdl_set_color(color);
+
+    for (i = 0; i+1 < count; i += 2) {
+        p = &points[i];
+        if (p[0].x < 0 || p[0].x >= pane->w || p[0].y < 0 || p[0].y >= pane->h ||
+            p[1].x < 0 || p[1].x >= pane->w || p[1].y < 0 || p[1].y >= pane->h)
+        {
+            continue;
+        }
+        SDL_RenderDrawLine(sdl_renderer, 
+                           p[0].x + pane->x, p[0].y + pane->y,
+                           p[1].x + pane->x, p[1].y + pane->y);
+    }
+}
+
 void sdl_render_circle(rect_t * pane, int32_t x_center, int32_t y_center, int32_t radius,
                        int32_t line_width, int32_t color)
 {
@@ -1628,6 +1983,18 @@ void sdl_update_texture(texture_t texture, uint8_t * pixels, int32_t pitch)
                       pitch*BYTES_PER_PIXEL); // pitch  
 }
 
+// update the loc area of the texture; the pixels arg points to the first 
+// pixel of the area, and pitch is the width of the caller's pixel buffer
+void sdl_update_texture_rect(texture_t texture, rect_t * loc, uint8_t * pixels, int32_t pitch) 
+{
+    SDL_Rect rect = {loc->x, loc->y, loc->w, loc->h};
+
+    SDL_UpdateTexture((SDL_Texture*)texture,
+                      &rect,                  // update area
+                      pixels,                 // pixels
+                      pitch*BYTES_PER_PIXEL); // pitch  
+}
+
 void sdl_query_texture(texture_t texture, int32_t * width, int32_t * height)
 {
     if (texture == NULL) {
@@ -1770,11 +2137,27 @@ void sdl_destroy_texture(texture_t texture)
 
 // -----------------  PRINT SCREEN -------------------------------------- 
 
-void sdl_print_screen(char *file_name, bool flash_display, rect_t * rect_arg) 
+// the display pixels are read by the caller's thread, which must be the thread that 
+// renders the display; and the pixels are written to file_name by one of the encoder 
+// threads, so that the display is not stalled while the jpg or png file is written;
+// returns -1 if the pixels could not be read, or if MAX_ENCODER_JOB files are already
+// waiting to be written
+int32_t sdl_print_screen(char *file_name, bool flash_display, rect_t * rect_arg) 
 {
     uint8_t * pixels = NULL;
     SDL_Rect  rect;
-    int32_t   ret, len;
+    int32_t   ret, len, i;
+    sdl_encoder_job_t * job;
+
+    // filename must have .jpg or .png extension
+    len = strlen(file_name);
+    if (len >= PATH_MAX ||
+        len <= 4 || 
+        (strcmp(file_name+len-4, ".jpg") != 0 && strcmp(file_name+len-4, ".png") != 0))
+    {
+        ERROR("filename %s must have .jpg or .png extension\n", file_name);
+        return -1;
+    }
 
     // if caller has supplied region to print then 
     //   init rect to print with caller supplied position
@@ -1793,11 +2176,20 @@ void sdl_print_screen(char *file_name, bool flash_display, rect_t * rect_arg)
         rect.h = sdl_win_height;   
     }
 
+    // if the encoder job queue is full then fail
+    pthread_mutex_lock(&sdl_encoder_mutex);
+    if ((sdl_encoder_job_tail + 1) % MAX_ENCODER_JOB == sdl_encoder_job_head) {
+        pthread_mutex_unlock(&sdl_encoder_mutex);
+        WARN("print screen %s dropped, encoders are busy\n", file_name);
+        return -1;
+    }
+    pthread_mutex_unlock(&sdl_encoder_mutex);
+
     // allocate memory for pixels
     pixels = calloc(1, rect.w * rect.h * BYTES_PER_PIXEL);
     if (pixels == NULL) {
         ERROR("allocate pixels failed\n");
-        return;
+        return -1;
     }
 
     // copy display rect to pixels
@@ -1809,42 +2201,88 @@ void sdl_print_screen(char *file_name, bool flash_display, rect_t * rect_arg)
     if (ret < 0) {
         ERROR("SDL_RenderReadPixels, %s\n", SDL_GetError());
         free(pixels);
-        return;
+        return -1;
     }
 
-    // write pixels to file_name, 
-    // filename must have .jpg or .png extension
-    len = strlen(file_name);
-    if (len > 4 && strcmp(file_name+len-4, ".jpg") == 0) {
-        ret = write_jpeg_file(file_name, pixels, rect.w, rect.h);
-        if (ret != 0) {
-            ERROR("write_jpeg_file %s failed\n", file_name);
+    // queue the pixels to be written by an encoder thread, which frees the pixels;
+    // on first call create the encoder threads
+    pthread_mutex_lock(&sdl_encoder_mutex);
+    if (!sdl_encoder_started) {
+        for (i = 0; i < MAX_ENCODER_THREAD; i++) {
+            pthread_t thread_id;
+            pthread_create(&thread_id, NULL, sdl_encoder_thread, NULL);
         }
-    } else if (len > 4 && strcmp(file_name+len-4, ".png") == 0) {
-        ret = write_png_file(file_name, pixels, rect.w, rect.h);
-        if (ret != 0) {
-            ERROR("write_png_file %s failed\n", file_name);
-        }
-    } else {
-        ret = -1;
-        ERROR("filename %s must have .jpg or .png extension\n", file_name);
-    }
-    if (ret != 0) {
-        free(pixels);
-        return;
-    }
-
-    // it worked, flash display if enabled;
-    // the caller must redraw the screen if flash_display is enabled
-    if (flash_display) {
+        sdl_encoder_started = true;
+    }
+    job = &sdl_encoder_job[sdl_encoder_job_tail];
+    strcpy(job->file_name, file_name);
+    job->pixels = pixels;
+    job->w = rect.w;
+    job->h = rect.h;
+    sdl_encoder_job_tail = (sdl_encoder_job_tail + 1) % MAX_ENCODER_JOB;
+    pthread_cond_broadcast(&sdl_encoder_cond);
+    pthread_mutex_unlock(&sdl_encoder_mutex);
+
+    // flash display if enabled; the display is black until it is next 
+    // redrawn, so the caller must redraw the screen if flash_display is enabled
+    if (flash_display && sdl_offscreen_surface == NULL) {
         sdl_set_color(BLACK);
         SDL_RenderClear(sdl_renderer);
         SDL_RenderPresent(sdl_renderer);
-        usleep(250000);
     }
 
-    // free pixels
-    free(pixels);
+    return 0;
+}
+
+static void * sdl_encoder_thread(void * cx)
+{
+    sdl_encoder_job_t job;
+    int32_t ret, len;
+
+    while (true) {
+        // wait for a job
+        pthread_mutex_lock(&sdl_encoder_mutex);
+        while (sdl_encoder_job_head == sdl_encoder_job_tail) {
+            pthread_cond_wait(&sdl_encoder_cond, &sdl_encoder_mutex);
+        }
+        job = sdl_encoder_job[sdl_encoder_job_head];
+        sdl_encoder_job_head = (sdl_encoder_job_head + 1) % MAX_ENCODER_JOB;
+        sdl_encoder_busy++;
+        pthread_mutex_unlock(&sdl_encoder_mutex);
+
+        // write pixels to file_name
+        len = strlen(job.file_name);
+        if (strcmp(job.file_name+len-4, ".jpg") == 0) {
+            ret = write_jpeg_file(job.file_name, job.pixels, job.w, job.h);
+            if (ret != 0) {
+                ERROR("write_jpeg_file %s failed\n", job.file_name);
+            }
+        } else {
+            ret = write_png_file(job.file_name, job.pixels, job.w, job.h);
+            if (ret != 0) {
+                ERROR("write_png_file %s failed\n", job.file_name);
+            }
+        }
+        free(job.pixels);
+
+        // done with this job
+        pthread_mutex_lock(&sdl_encoder_mutex);
+        sdl_encoder_busy--;
+        pthread_cond_broadcast(&sdl_encoder_cond);
+        pthread_mutex_unlock(&sdl_encoder_mutex);
+    }
+
+    return NULL;
+}
+
+static void sdl_encoder_wait_idle(void)
+{
+    // wait for all queued jobs to be written
+    pthread_mutex_lock(&sdl_encoder_mutex);
+    while (sdl_encoder_job_head != sdl_encoder_job_tail || sdl_encoder_busy > 0) {
+        pthread_cond_wait(&sdl_encoder_cond, &sdl_encoder_mutex);
+    }
+    pthread_mutex_unlock(&sdl_encoder_mutex);
 }
 
 static char * sdl_print_screen_filename(void)
@@ -1896,3 +2334,9 @@ int32_t sdl_color(char * color_str)
     return -1;
 }
 
+
+// convert color to the pixel value used by textures created by sdl_create_texture
+uint32_t sdl_color_to_pixel(int32_t color)
+{
+    return _bswap32(sdl_color_to_rgba[color]);
+}
@@ -97,6 +97,7 @@ typedef void * texture_t;
 #define SDL_EVENT_WIN_SIZE_CHANGE        0x8001
 #define SDL_EVENT_WIN_MINIMIZED          0x8002
 #define SDL_EVENT_WIN_RESTORED           0x8003
+#define SDL_EVENT_WIN_EXPOSED            0x8004
 // - program quit event
 #define SDL_EVENT_QUIT                   0x8fff
 // - user defined events base
@@ -165,14 +166,16 @@ typedef struct pane_cx_s {
 // PROTOTYPES
 //
 
-// sdl initialize
-int32_t sdl_init(int32_t * w, int32_t * h, bool resizeable);
+// sdl initialize; when offscreen is set the display is rendered by the software
+// renderer to a w x h surface in memory, and no window is created
+int32_t sdl_init(int32_t * w, int32_t * h, bool resizeable, bool offscreen);
 void sdl_get_max_texture_dim(int32_t * max_texture_dim);
 
 // pane support
 void sdl_pane_manager(void *display_cx,                        // optional, context
                       void (*display_start)(void *display_cx), // optional, called prior to pane handlers
                       void (*display_end)(void *display_cx),   // optional, called after pane handlers
+                      bool (*redraw_needed)(void *display_cx), // optional, returns true if display changed
                       int64_t redraw_interval_us,              // 0=continuous, -1=never, else us
                       int32_t count,                           // number of pane handler varargs that follow
                       ...);                                    // pane_handler, init_params, x_disp, y_disp, w, h, border_style
@@ -215,6 +218,7 @@ void sdl_render_rect(rect_t * pane, rect_t * loc, int32_t line_width, int32_t co
 void sdl_render_fill_rect(rect_t * pane, rect_t * loc, int32_t color);
 void sdl_render_line(rect_t * pane, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t color);
 void sdl_render_lines(rect_t * pane, point_t * points, int32_t count, int32_t color);
+void sdl_render_line_segments(rect_t * pane, point_t * points, int32_t count, int32_t color);
 void sdl_render_circle(rect_t * pane, int32_t x_center, int32_t y_center, int32_t radius, 
             int32_t line_width, int32_t color);
 void sdl_render_point(rect_t * pane, int32_t x, int32_t y, int32_t color, int32_t point_size);
@@ -226,15 +230,17 @@ texture_t sdl_create_texture_from_pane_pixels(rect_t * pane);
 texture_t sdl_create_filled_circle_texture(int32_t radius, int32_t color);
 texture_t sdl_create_text_texture(int32_t fg_color, int32_t bg_color, int32_t font_ptsize, char * str);
 void sdl_update_texture(texture_t texture, uint8_t * pixels, int32_t pitch);
+void sdl_update_texture_rect(texture_t texture, rect_t * loc, uint8_t * pixels, int32_t pitch);
 void sdl_query_texture(texture_t texture, int32_t * width, int32_t * height);
 rect_t sdl_render_texture(rect_t * pane, int32_t x, int32_t y, texture_t texture);
 rect_t sdl_render_scaled_texture(rect_t * pane, rect_t * loc, texture_t texture);
 void sdl_destroy_texture(texture_t texture);
 
 // print screen, file_name must end in .jpg or .png
-void sdl_print_screen(char * file_name, bool flash_display, rect_t * rect);
+int32_t sdl_print_screen(char * file_name, bool flash_display, rect_t * rect);
 
 // misc
 int32_t sdl_color(char * color_str);
+uint32_t sdl_color_to_pixel(int32_t color);
 
 #endif
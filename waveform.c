@@ -0,0 +1,483 @@
+/*
+Copyright (c) 2018 Steven Haid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "common.h"
+
+//
+// defines
+//
+
+// square wave rise time, as a fraction of the period
+#define SQUARE_RISE_TIME .01
+
+//
+// typedefs
+//
+
+// table used by the pwl and file wave forms;
+// - pwl:  t[] are the breakpoint times, v[] are the volts at these times
+// - file: t[] are the sample times within one period, v[] are the 
+//         samples scaled by the power supply volts
+typedef struct waveform_table_s {
+    int32_t       max;
+    int32_t       alloced;
+    int32_t       last_idx;
+    char        * spec;
+    long double * t;
+    long double * v;
+} waveform_table_t;
+
+//
+// variables
+//
+
+static char * wave_form_str[] = { "dc", "sine", "square", "triangle", "pulse", "pwl", "file" };
+
+//
+// prototypes
+//
+
+static int32_t parse_pwl(component_t * c, char * spec);
+static int32_t parse_file(component_t * c, char * filename);
+static waveform_table_t * table_alloc(char * spec);
+static void table_add(waveform_table_t * tbl, long double t, long double v);
+static void table_free(waveform_table_t * tbl);
+static long double table_lookup(waveform_table_t * tbl, long double t);
+static long double next_periodic_breakpoint(long double t, long double hz, long double * phase, int32_t max_phase);
+
+// -----------------  PUBLIC  --------------------------------------------------------
+
+// parse the power supply value_str, and init the component power fields;
+// the formats supported are:
+// - volts                                    dc
+// - volts,hz[,sine|square|triangle]          sine is the default
+// - volts,hz,pulse,rise,fall,width           pulse from 0 to volts
+// - pwl,t:volts,t:volts,...                  piecewise linear
+// - volts,hz,file,filename                   one period of samples from file
+int32_t waveform_parse(component_t * c, char * value_str)
+{
+    char *s, *saveptr;
+
+    memset(&c->power, 0, sizeof(c->power));
+
+    if (value_str == NULL) {
+        return -1;
+    }
+    if (strlen(value_str) > MAX_WAVEFORM_STR) {
+        ERROR("power supply value is longer than %d chars\n", MAX_WAVEFORM_STR);
+        return -1;
+    }
+
+    // pwl does not have the volts and hz fields
+    if (strncasecmp(value_str, "pwl,", 4) == 0) {
+        c->power.wave_form = WAVE_FORM_PWL;
+        return parse_pwl(c, value_str);
+    }
+
+    // volts
+    s = strtok_r(value_str, ",", &saveptr);
+    if (str_to_val(s, UNITS_VOLTS, &c->power.volts) == -1) {
+        return -1;
+    }
+
+    // hz, if not supplied then this is dc
+    s = strtok_r(NULL, ",", &saveptr);
+    if (s == NULL) {
+        c->power.wave_form = WAVE_FORM_DC;
+        return 0;
+    }
+    if (str_to_val(s, UNITS_HZ, &c->power.hz) == -1 || c->power.hz <= 0) {
+        return -1;
+    }
+
+    // wave form
+    s = strtok_r(NULL, ",", &saveptr);
+    if (s == NULL || strcasecmp(s, "sine") == 0) {
+        c->power.wave_form = WAVE_FORM_SINE;
+    } else if (strcasecmp(s, "square") == 0) {
+        c->power.wave_form = WAVE_FORM_SQUARE;
+    } else if (strcasecmp(s, "triangle") == 0) {
+        c->power.wave_form = WAVE_FORM_TRIANGLE;
+    } else if (strcasecmp(s, "pulse") == 0) {
+        c->power.wave_form = WAVE_FORM_PULSE;
+        if ((str_to_val(strtok_r(NULL, ",", &saveptr), UNITS_SECONDS, &c->power.rise) == -1) ||
+            (str_to_val(strtok_r(NULL, ",", &saveptr), UNITS_SECONDS, &c->power.fall) == -1) ||
+            (str_to_val(strtok_r(NULL, ",", &saveptr), UNITS_SECONDS, &c->power.width) == -1) ||
+            (c->power.rise < 0 || c->power.fall < 0 || c->power.width < 0) ||
+            (c->power.rise + c->power.fall + c->power.width > 1 / c->power.hz))
+        {
+            return -1;
+        }
+    } else if (strcasecmp(s, "file") == 0) {
+        c->power.wave_form = WAVE_FORM_FILE;
+        return parse_file(c, strtok_r(NULL, "", &saveptr));
+    } else {
+        return -1;
+    }
+
+    // there should be nothing more
+    if (strtok_r(NULL, "", &saveptr) != NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// convert the component power fields back to the value_str format
+// that is accepted by waveform_parse; the result is truncated to size
+char * waveform_to_str(component_t * c, char * s, int32_t size)
+{
+    char volts[50], hz[50], rise[50], fall[50], width[50];
+
+    if (c->power.wave_form == WAVE_FORM_PWL) {
+        snprintf(s, size, "%s", c->power.table->spec);
+        return s;
+    }
+
+    val_to_str(c->power.volts, UNITS_VOLTS, volts, true);
+    val_to_str(c->power.hz, UNITS_HZ, hz, true);
+    switch (c->power.wave_form) {
+    case WAVE_FORM_DC:
+        snprintf(s, size, "%s", volts);
+        break;
+    case WAVE_FORM_SINE:
+        snprintf(s, size, "%s,%s", volts, hz);
+        break;
+    case WAVE_FORM_PULSE:
+        val_to_str(c->power.rise, UNITS_SECONDS, rise, true);
+        val_to_str(c->power.fall, UNITS_SECONDS, fall, true);
+        val_to_str(c->power.width, UNITS_SECONDS, width, true);
+        snprintf(s, size, "%s,%s,pulse,%s,%s,%s", volts, hz, rise, fall, width);
+        break;
+    case WAVE_FORM_FILE:
+        snprintf(s, size, "%s,%s,file,%s", volts, hz, c->power.table->spec);
+        break;
+    default:
+        snprintf(s, size, "%s,%s,%s", volts, hz, wave_form_str[c->power.wave_form]);
+        break;
+    }
+
+    return s;
+}
+
+// free the table used by the pwl and file wave forms
+void waveform_free(component_t * c)
+{
+    if (c->type != COMP_POWER || c->power.table == NULL) {
+        return;
+    }
+
+    table_free(c->power.table);
+    c->power.table = NULL;
+}
+
+// return the frequency that should be used when determining auto_delta_t;
+// for pwl this is based on the shortest segment
+long double waveform_hz(component_t * c)
+{
+    waveform_table_t * tbl = c->power.table;
+    long double min_interval = 0;
+    int32_t i;
+
+    if (c->power.wave_form != WAVE_FORM_PWL) {
+        return c->power.hz;
+    }
+
+    for (i = 1; i < tbl->max; i++) {
+        long double interval = tbl->t[i] - tbl->t[i-1];
+        if (interval > 0 && (min_interval == 0 || interval < min_interval)) {
+            min_interval = interval;
+        }
+    }
+    return min_interval ? 1 / min_interval : 0;
+}
+
+// return the power supply voltage at time t;
+// this is called by the model once per time step for each power supply
+long double waveform_eval(component_t * c, long double t)
+{
+    long double volts = c->power.volts;
+    long double phase, v;
+
+    // phase is the fraction of the period that has elapsed, evaluating 
+    // this way avoids loss of precision when t is much larger than the period
+    phase = t * c->power.hz;
+    phase -= floorl(phase);
+
+    switch (c->power.wave_form) {
+    case WAVE_FORM_DC:
+        v = volts;
+        break;
+    case WAVE_FORM_SINE:
+        v = volts * sinl(phase * (2. * M_PI));
+        break;
+    case WAVE_FORM_SQUARE: {
+        long double slope = 2 * volts / SQUARE_RISE_TIME;
+        if (phase < SQUARE_RISE_TIME) {
+            v = -volts + slope * phase;
+        } else if (phase < 0.5) {
+            v = volts;
+        } else if (phase < 0.5 + SQUARE_RISE_TIME) {
+            v = volts - slope * (phase - 0.5);
+        } else {
+            v = -volts;
+        }
+        break; }
+    case WAVE_FORM_TRIANGLE:
+        // shift by a quarter period so that the triangle is in phase with sine
+        phase += 0.25;
+        if (phase >= 1) {
+            phase -= 1;
+        }
+        v = volts * (1 - 4 * fabsl(phase - 0.5));
+        break;
+    case WAVE_FORM_PULSE: {
+        long double tp = phase / c->power.hz;
+        if (tp < c->power.rise) {
+            v = volts * tp / c->power.rise;
+        } else if (tp < c->power.rise + c->power.width) {
+            v = volts;
+        } else if (tp < c->power.rise + c->power.width + c->power.fall) {
+            v = volts * (1 - (tp - c->power.rise - c->power.width) / c->power.fall);
+        } else {
+            v = 0;
+        }
+        break; }
+    case WAVE_FORM_PWL:
+        v = table_lookup(c->power.table, t);
+        break;
+    case WAVE_FORM_FILE:
+        v = table_lookup(c->power.table, phase);
+        break;
+    default:
+        FATAL("invalid wave_form %d\n", c->power.wave_form);
+        v = 0;
+        break;
+    }
+
+    return v;
+}
+
+// return the time of the wave form's next breakpoint after time t; a breakpoint 
+// is where the wave form, or its slope, is discontinuous;
+// INFINITY is returned if there are no more breakpoints
+long double waveform_next_breakpoint(component_t * c, long double t)
+{
+    waveform_table_t * tbl = c->power.table;
+    long double phase[4];
+    int32_t i;
+
+    switch (c->power.wave_form) {
+    case WAVE_FORM_SQUARE:
+        phase[0] = 0;
+        phase[1] = SQUARE_RISE_TIME;
+        phase[2] = 0.5;
+        phase[3] = 0.5 + SQUARE_RISE_TIME;
+        return next_periodic_breakpoint(t, c->power.hz, phase, 4);
+    case WAVE_FORM_TRIANGLE:
+        phase[0] = 0.25;
+        phase[1] = 0.75;
+        return next_periodic_breakpoint(t, c->power.hz, phase, 2);
+    case WAVE_FORM_PULSE:
+        phase[0] = 0;
+        phase[1] = c->power.rise * c->power.hz;
+        phase[2] = (c->power.rise + c->power.width) * c->power.hz;
+        phase[3] = (c->power.rise + c->power.width + c->power.fall) * c->power.hz;
+        return next_periodic_breakpoint(t, c->power.hz, phase, 4);
+    case WAVE_FORM_PWL:
+        for (i = 0; i < tbl->max; i++) {
+            if (tbl->t[i] > t) {
+                return tbl->t[i];
+            }
+        }
+        return INFINITY;
+    case WAVE_FORM_FILE:
+        // the final table entry is the start of the next period
+        return next_periodic_breakpoint(t, c->power.hz, tbl->t, tbl->max-1);
+    default:
+        // dc and sine do not have breakpoints
+        return INFINITY;
+    }
+}
+
+// -----------------  PRIVATE  -------------------------------------------------------
+
+static int32_t parse_pwl(component_t * c, char * spec)
+{
+    waveform_table_t * tbl;
+    char *s, *colon, *saveptr;
+    long double t, v;
+
+    tbl = table_alloc(spec);
+
+    // skip over "pwl", and parse the t:volts pairs
+    strtok_r(spec, ",", &saveptr);
+    while ((s = strtok_r(NULL, ",", &saveptr)) != NULL) {
+        if ((colon = strchr(s, ':')) == NULL) {
+            goto error;
+        }
+        *colon = '\0';
+        if ((str_to_val(s, UNITS_SECONDS, &t) == -1) ||
+            (str_to_val(colon+1, UNITS_VOLTS, &v) == -1) ||
+            (tbl->max > 0 && t < tbl->t[tbl->max-1]))
+        {
+            goto error;
+        }
+        table_add(tbl, t, v);
+    }
+    if (tbl->max == 0) {
+        goto error;
+    }
+
+    c->power.table = tbl;
+    return 0;
+
+error:
+    table_free(tbl);
+    return -1;
+}
+
+static int32_t parse_file(component_t * c, char * filename)
+{
+    waveform_table_t * tbl;
+    FILE * fp;
+    char s[200];
+    int32_t i, max;
+    long double sample;
+
+    if (filename == NULL) {
+        return -1;
+    }
+
+    fp = fopen(filename, "r");
+    if (fp == NULL) {
+        ERROR("unable to open '%s', %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    tbl = table_alloc(filename);
+
+    // read one sample per line, lines beginning with '#' are comments;
+    // the samples are scaled by volts
+    while (fgets(s, sizeof(s), fp) != NULL) {
+        if (s[0] == '#' || sscanf(s, "%Lf", &sample) != 1) {
+            continue;
+        }
+        table_add(tbl, 0, sample * c->power.volts);
+    }
+    fclose(fp);
+    if (tbl->max < 2) {
+        ERROR("file '%s' has less than 2 samples\n", filename);
+        table_free(tbl);
+        return -1;
+    }
+
+    // the samples are equally spaced over the period, the final entry
+    // repeats the first sample so that the interpolation wraps around
+    max = tbl->max;
+    for (i = 0; i < max; i++) {
+        tbl->t[i] = (long double)i / max;
+    }
+    table_add(tbl, 1, tbl->v[0]);
+
+    c->power.table = tbl;
+    return 0;
+}
+
+static waveform_table_t * table_alloc(char * spec)
+{
+    waveform_table_t * tbl;
+
+    tbl = calloc(1, sizeof(waveform_table_t));
+    tbl->spec = strdup(spec);
+    return tbl;
+}
+
+static void table_add(waveform_table_t * tbl, long double t, long double v)
+{
+    if (tbl->max == tbl->alloced) {
+        tbl->alloced = (tbl->alloced == 0 ? 16 : 2 * tbl->alloced);
+        tbl->t = realloc(tbl->t, tbl->alloced * sizeof(long double));
+        tbl->v = realloc(tbl->v, tbl->alloced * sizeof(long double));
+    }
+    tbl->t[tbl->max] = t;
+    tbl->v[tbl->max] = v;
+    tbl->max++;
+}
+
+static void table_free(waveform_table_t * tbl)
+{
+    free(tbl->spec);
+    free(tbl->t);
+    free(tbl->v);
+    free(tbl);
+}
+
+// linear interpolation of the table; the search starts at the index found 
+// by the prior call because t is usually increasing by a small amount
+static long double table_lookup(waveform_table_t * tbl, long double t)
+{
+    int32_t idx = tbl->last_idx;
+
+    if (t <= tbl->t[0]) {
+        return tbl->v[0];
+    }
+    if (t >= tbl->t[tbl->max-1]) {
+        return tbl->v[tbl->max-1];
+    }
+
+    if (t < tbl->t[idx]) {
+        idx = 0;
+    }
+    while (t >= tbl->t[idx+1]) {
+        idx++;
+    }
+    tbl->last_idx = idx;
+
+    // t is in the interval t[idx] to t[idx+1]
+    if (tbl->t[idx+1] == tbl->t[idx]) {
+        return tbl->v[idx+1];
+    }
+    return tbl->v[idx] + 
+           (tbl->v[idx+1] - tbl->v[idx]) * (t - tbl->t[idx]) / (tbl->t[idx+1] - tbl->t[idx]);
+}
+
+// the phase[] values are the breakpoints as fractions of the period; 
+// the candidate breakpoints are checked in the cycles adjacent to t
+// to allow for rounding in the calculation of the cycle
+static long double next_periodic_breakpoint(long double t, long double hz, long double * phase, int32_t max_phase)
+{
+    long double period = 1 / hz;
+    long double cycle = floorl(t * hz);
+    long double bp, next_bp = INFINITY;
+    int32_t i, j;
+
+    for (i = -1; i <= 1; i++) {
+        for (j = 0; j < max_phase; j++) {
+            bp = (cycle + i) * period + phase[j] * period;
+            if (bp > t && bp < next_bp) {
+                next_bp = bp;
+            }
+        }
+    }
+    return next_bp;
+}